@@ -0,0 +1,296 @@
+#include "archivegenerator.h"
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <zlib.h>
+
+static void put16(QByteArray &data, quint16 value)
+{
+    data.append(static_cast<char>(value & 0xff));
+    data.append(static_cast<char>(value >> 8));
+}
+
+static void put32(QByteArray &data, quint32 value)
+{
+    put16(data, static_cast<quint16>(value & 0xffff));
+    put16(data, static_cast<quint16>(value >> 16));
+}
+
+ArchiveGenerator::ArchiveGenerator(quint32 seed, double scale)
+    : random(seed)
+{
+    this->scale = scale;
+}
+
+QString ArchiveGenerator::errorString() const
+{
+    return error;
+}
+
+bool ArchiveGenerator::xmage(const QString &fileName)
+{
+    if (!open(fileName))
+    {
+        return false;
+    }
+    bool ok = addDirectory("xmage/");
+    const char *libDirs[] = { "xmage/mage-client/lib/", "xmage/mage-server/lib/" };
+    for (const char *dir : libDirs)
+    {
+        ok = ok && addDirectory(dir);
+        // Jars are zips themselves, so they are stored and incompressible
+        int jars = scaled(1000);
+        for (int i = 0; i < jars && ok; i++)
+        {
+            ok = addFile(QString("%1mage-lib-%2-1.4.%3.jar").arg(dir).arg(i).arg(i % 57),
+                         randomBytes(logUniform(4 * 1024, 600 * 1024)), false);
+        }
+    }
+
+    // Plugins sit a few levels down, one directory per plugin
+    int plugins = scaled(60);
+    for (int i = 0; i < plugins && ok; i++)
+    {
+        QString dir = QString("xmage/mage-server/plugins/mage-game-%1/target/classes/mage/game/variant%2/")
+                          .arg(i % 12)
+                          .arg(i);
+        ok = addDirectory(dir);
+        for (int j = 0; j < 5 && ok; j++)
+        {
+            ok = addFile(dir + QString("plugin-%1.jar").arg(j), randomBytes(logUniform(2 * 1024, 200 * 1024)), false);
+        }
+    }
+
+    // A few large, very compressible database files
+    const char *dbDirs[] = { "xmage/mage-client/db/", "xmage/mage-server/db/" };
+    const qint64 dbSizes[] = { 64, 16, 8 };
+    for (const char *dir : dbDirs)
+    {
+        ok = ok && addDirectory(dir);
+        for (int i = 0; i < 3 && ok; i++)
+        {
+            qint64 size = static_cast<qint64>(dbSizes[i] * 1024 * 1024 * scale);
+            ok = addFile(QString("%1cards-%2.h2.mv.db").arg(dir).arg(i), databaseBytes(size), true);
+        }
+    }
+
+    const char *configs[] = { "xmage/mage-client/config/config.xml", "xmage/mage-server/config/config.xml",
+                              "xmage/mage-client/startClient.sh", "xmage/mage-server/startServer.sh" };
+    ok = ok && addDirectory("xmage/mage-client/config/") && addDirectory("xmage/mage-server/config/");
+    for (const char *name : configs)
+    {
+        ok = ok && addFile(name, databaseBytes(8 * 1024), true);
+    }
+    return ok && close();
+}
+
+bool ArchiveGenerator::decks(const QString &fileName)
+{
+    if (!open(fileName))
+    {
+        return false;
+    }
+    const char *formats[] = { "Standard", "Pioneer", "Modern", "Legacy", "Vintage", "Pauper", "Commander" };
+    bool ok = addDirectory("decks/");
+    int files = qMin(scaled(30000), ARCHIVE_MAX_ENTRIES - 1000);
+    int perDirectory = 100;
+    for (int i = 0; i < files && ok; i++)
+    {
+        const char *format = formats[(i / perDirectory) % 7];
+        QString dir = QString("decks/%1/archetype-%2/").arg(format).arg(i / perDirectory);
+        if (i % perDirectory == 0)
+        {
+            ok = addDirectory(QString("decks/%1/").arg(format)) && addDirectory(dir);
+        }
+        ok = ok && addFile(dir + QString("deck-%1.dck").arg(i), deckBytes(logUniform(200, 3000)), true);
+    }
+    return ok && close();
+}
+
+bool ArchiveGenerator::open(const QString &fileName)
+{
+    written.clear();
+    directories.clear();
+    out.setFileName(fileName);
+    if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        error = "Error creating " + fileName;
+        return false;
+    }
+    return true;
+}
+
+bool ArchiveGenerator::addDirectory(const QString &name)
+{
+    if (directories.contains(name))
+    {
+        return true;
+    }
+    directories.insert(name);
+    return addFile(name, QByteArray(), false);
+}
+
+bool ArchiveGenerator::addFile(const QString &name, const QByteArray &data, bool deflated)
+{
+    if (written.size() >= ARCHIVE_MAX_ENTRIES)
+    {
+        error = "Too many entries for a zip without zip64";
+        return false;
+    }
+
+    QByteArray payload = data;
+    if (deflated && !data.isEmpty())
+    {
+        z_stream deflater;
+        memset(&deflater, 0, sizeof(deflater));
+        deflateInit2(&deflater, 6, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+        payload.resize(static_cast<qsizetype>(deflateBound(&deflater, static_cast<uLong>(data.size()))));
+        deflater.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.constData()));
+        deflater.avail_in = static_cast<uInt>(data.size());
+        deflater.next_out = reinterpret_cast<Bytef *>(payload.data());
+        deflater.avail_out = static_cast<uInt>(payload.size());
+        deflate(&deflater, Z_FINISH);
+        payload.resize(static_cast<qsizetype>(deflater.total_out));
+        deflateEnd(&deflater);
+    }
+
+    ZipEntry entry;
+    entry.name = name;
+    entry.flags = 0x0800; // UTF-8 names
+    entry.method = deflated ? 8 : 0;
+    entry.crc = static_cast<quint32>(crc32(crc32(0, Z_NULL, 0), reinterpret_cast<const Bytef *>(data.constData()),
+                                           static_cast<uInt>(data.size())));
+    entry.compressedSize = static_cast<quint64>(payload.size());
+    entry.uncompressedSize = static_cast<quint64>(data.size());
+    entry.localHeaderOffset = static_cast<quint64>(out.pos());
+    entry.externalAttributes = (name.endsWith('/') ? 040755u : 0100644u) << 16;
+
+    QByteArray nameBytes = name.toUtf8();
+    QByteArray header;
+    put32(header, ZIP_LOCAL_HEADER_SIGNATURE);
+    put16(header, 20);
+    put16(header, entry.flags);
+    put16(header, entry.method);
+    put16(header, ARCHIVE_DOS_TIME);
+    put16(header, ARCHIVE_DOS_DATE);
+    put32(header, entry.crc);
+    put32(header, static_cast<quint32>(entry.compressedSize));
+    put32(header, static_cast<quint32>(entry.uncompressedSize));
+    put16(header, static_cast<quint16>(nameBytes.size()));
+    put16(header, 0);
+    header.append(nameBytes);
+    if (out.write(header) != header.size() || out.write(payload) != payload.size())
+    {
+        error = "Error writing " + out.fileName();
+        return false;
+    }
+    written.append(entry);
+    return true;
+}
+
+bool ArchiveGenerator::close()
+{
+    qint64 directoryOffset = out.pos();
+    QByteArray directory;
+    for (const ZipEntry &entry : std::as_const(written))
+    {
+        QByteArray nameBytes = entry.name.toUtf8();
+        put32(directory, ZIP_CENTRAL_HEADER_SIGNATURE);
+        put16(directory, 0x031e); // Made by Unix, spec 3.0
+        put16(directory, 20);
+        put16(directory, entry.flags);
+        put16(directory, entry.method);
+        put16(directory, ARCHIVE_DOS_TIME);
+        put16(directory, ARCHIVE_DOS_DATE);
+        put32(directory, entry.crc);
+        put32(directory, static_cast<quint32>(entry.compressedSize));
+        put32(directory, static_cast<quint32>(entry.uncompressedSize));
+        put16(directory, static_cast<quint16>(nameBytes.size()));
+        put16(directory, 0);
+        put16(directory, 0);
+        put16(directory, 0);
+        put16(directory, 0);
+        put32(directory, entry.externalAttributes);
+        put32(directory, static_cast<quint32>(entry.localHeaderOffset));
+        directory.append(nameBytes);
+    }
+    qint64 directorySize = directory.size();
+    put32(directory, ZIP_END_OF_CENTRAL_DIR_SIGNATURE);
+    put16(directory, 0);
+    put16(directory, 0);
+    put16(directory, static_cast<quint16>(written.size()));
+    put16(directory, static_cast<quint16>(written.size()));
+    put32(directory, static_cast<quint32>(directorySize));
+    put32(directory, static_cast<quint32>(directoryOffset));
+    put16(directory, 0);
+
+    bool ok = out.write(directory) == directory.size();
+    out.close();
+    if (!ok || out.error() != QFileDevice::NoError)
+    {
+        error = "Error writing " + out.fileName();
+        return false;
+    }
+    return true;
+}
+
+int ArchiveGenerator::scaled(int count) const
+{
+    return qMax(1, static_cast<int>(count * scale));
+}
+
+qint64 ArchiveGenerator::logUniform(qint64 low, qint64 high)
+{
+    // Most files small, a long tail of big ones, like real jars
+    std::uniform_real_distribution<double> distribution(std::log(static_cast<double>(low)),
+                                                        std::log(static_cast<double>(high)));
+    return static_cast<qint64>(std::exp(distribution(random)));
+}
+
+QByteArray ArchiveGenerator::randomBytes(qint64 size)
+{
+    QByteArray data(static_cast<qsizetype>(size), Qt::Uninitialized);
+    qint64 i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        quint64 value = random();
+        memcpy(data.data() + i, &value, 8);
+    }
+    quint64 value = random();
+    memcpy(data.data() + i, &value, static_cast<size_t>(size - i));
+    return data;
+}
+
+QByteArray ArchiveGenerator::databaseBytes(qint64 size)
+{
+    // Repetitive records with a little variation, roughly as compressible
+    // as the card database
+    QByteArray data;
+    data.reserve(static_cast<qsizetype>(size + 128));
+    std::uniform_int_distribution<int> number(0, 99999);
+    while (data.size() < size)
+    {
+        data.append(QString("INSERT INTO CARD VALUES(%1,'Card Name %2','SET%3','{%4}{W}{U}',%5,'Creature - Human Wizard');\n")
+                        .arg(number(random))
+                        .arg(number(random))
+                        .arg(number(random) % 300)
+                        .arg(number(random) % 10)
+                        .arg(number(random) % 5)
+                        .toLatin1());
+    }
+    data.truncate(static_cast<qsizetype>(size));
+    return data;
+}
+
+QByteArray ArchiveGenerator::deckBytes(qint64 size)
+{
+    QByteArray data;
+    std::uniform_int_distribution<int> card(0, 20000);
+    std::uniform_int_distribution<int> count(1, 4);
+    while (data.size() < size)
+    {
+        data.append(QString("%1 [SET:%2] Card Name %3\n").arg(count(random)).arg(card(random) % 400).arg(card(random)).toLatin1());
+    }
+    data.truncate(static_cast<qsizetype>(size));
+    return data;
+}
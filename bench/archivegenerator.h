@@ -0,0 +1,54 @@
+#ifndef ARCHIVEGENERATOR_H
+#define ARCHIVEGENERATOR_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QList>
+#include <QSet>
+#include <QString>
+#include <random>
+#include "zipdirectory.h"
+
+// Fixed DOS timestamp (2024-01-01 00:00) so archives are byte-identical
+// from run to run
+#define ARCHIVE_DOS_TIME 0x0000
+#define ARCHIVE_DOS_DATE 0x5821
+#define ARCHIVE_MAX_ENTRIES 65535
+
+// Writes reproducible synthetic zips for the extraction benchmark. The
+// same seed and scale always produce the same bytes.
+//
+// xmage(): a release-shaped archive under one root folder: thousands of
+// stored jars in mage-client/lib and mage-server/lib, plugin jars in a deep
+// tree, a few large deflated database files and small config files.
+//
+// decks(): tens of thousands of tiny deflated text files, like the
+// metagame decks archive.
+class ArchiveGenerator
+{
+public:
+    ArchiveGenerator(quint32 seed, double scale);
+    bool xmage(const QString &fileName);
+    bool decks(const QString &fileName);
+    QString errorString() const;
+
+private:
+    std::mt19937_64 random;
+    double scale;
+    QFile out;
+    QList<ZipEntry> written;
+    QSet<QString> directories;
+    QString error;
+
+    bool open(const QString &fileName);
+    bool addDirectory(const QString &name);
+    bool addFile(const QString &name, const QByteArray &data, bool deflated);
+    bool close();
+    int scaled(int count) const;
+    qint64 logUniform(qint64 low, qint64 high);
+    QByteArray randomBytes(qint64 size);
+    QByteArray databaseBytes(qint64 size);
+    QByteArray deckBytes(qint64 size);
+};
+
+#endif // ARCHIVEGENERATOR_H
@@ -0,0 +1,223 @@
+// Extraction throughput benchmark. Generates reproducible XMage- and
+// decks-shaped archives, extracts them headless through the launcher's
+// extractors and prints one JSON object per run on stdout:
+//
+//   {"scenario":"xmage/unzip","run":1,"inflate":"zlib","files":2313,"bytes":...,"seconds":...,
+//    "mb_per_s":...,"files_per_s":...,"syscalls_read":...,"syscalls_write":...,
+//    "peak_rss_kb":...,...}
+//
+// See ProcessCounters for where the syscall, disk and RSS figures come from.
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+#include <functional>
+#include "archivegenerator.h"
+#include "inflater.h"
+#include "processcounters.h"
+#include "unzipthread.h"
+#include "zipstreamthread.h"
+
+static void countTree(const QString &path, qint64 *files, qint64 *bytes)
+{
+    *files = 0;
+    *bytes = 0;
+    QDirIterator it(path, QDir::Files | QDir::Hidden, QDirIterator::Subdirectories);
+    while (it.hasNext())
+    {
+        it.next();
+        if (it.fileName() == INSTALL_INDEX_FILE)
+        {
+            continue;
+        }
+        (*files)++;
+        *bytes += it.fileInfo().size();
+    }
+}
+
+static bool runUnzip(const QString &archive, const QString &dest, bool stripRoot, const QStringList &cleanDirs,
+                     bool incremental, QString *error)
+{
+    UnzipThread thread(archive, dest, stripRoot, cleanDirs);
+    thread.setIncremental(incremental);
+    bool ok = false;
+    QObject::connect(&thread, &UnzipThread::unzip_complete, [&ok](QString) { ok = true; });
+    QObject::connect(&thread, &UnzipThread::unzip_fail, [error](QString message) { *error = message; });
+    thread.start();
+    thread.wait();
+    return ok;
+}
+
+static bool runStream(const QString &archive, const QString &dest, const QStringList &cleanDirs, QString *error)
+{
+    ZipStreamThread thread(dest, cleanDirs);
+    thread.setSourceFile(archive);
+    bool ok = false;
+    QObject::connect(&thread, &ZipStreamThread::extract_complete, [&ok](QString) { ok = true; });
+    QObject::connect(&thread, &ZipStreamThread::extract_fail, [error](QString message) { *error = message; });
+    thread.start();
+    thread.wait();
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("extractbench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Measures archive extraction throughput on synthetic XMage-shaped archives.");
+    parser.addHelpOption();
+    QCommandLineOption scaleOption("scale", "Size multiplier for the generated archives (default 1.0).", "factor", "1.0");
+    QCommandLineOption seedOption("seed", "Seed for the archive contents (default 1).", "seed", "1");
+    QCommandLineOption repeatOption("repeat", "Runs per scenario (default 3).", "count", "3");
+    QCommandLineOption workOption("work-dir", "Where archives are generated and extracted.", "path",
+                                  QDir::tempPath() + "/xmage-extractbench");
+    QCommandLineOption filterOption("scenario", "Only run scenarios whose name contains this.", "name");
+    QCommandLineOption inflateOption("inflate", "Inflate backend: zlib or libdeflate (default: best available).",
+                                     "backend");
+    parser.addOptions({ scaleOption, seedOption, repeatOption, workOption, filterOption, inflateOption });
+    parser.process(app);
+
+    double scale = parser.value(scaleOption).toDouble();
+    quint32 seed = parser.value(seedOption).toUInt();
+    int repeat = qMax(1, parser.value(repeatOption).toInt());
+    QString workDir = parser.value(workOption);
+    QString filter = parser.value(filterOption);
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    if (scale <= 0 || !QDir().mkpath(workDir))
+    {
+        err << "Invalid scale or work directory" << Qt::endl;
+        return 2;
+    }
+    if (parser.isSet(inflateOption))
+    {
+        QString name = parser.value(inflateOption);
+        Inflater::Backend backend = name == "libdeflate" ? Inflater::Libdeflate : Inflater::Zlib;
+        if ((name != "zlib" && name != "libdeflate") || !Inflater::isAvailable(backend))
+        {
+            err << "Inflate backend not available: " << name << Qt::endl;
+            return 2;
+        }
+        Inflater::setDefaultBackend(backend);
+    }
+
+    // Archives are reused across invocations; the name pins seed and scale
+    QString suffix = QString("-seed%1-x%2.zip").arg(seed).arg(scale);
+    QString xmageArchive = workDir + "/xmage" + suffix;
+    QString decksArchive = workDir + "/decks" + suffix;
+    // One generator per archive, so each depends on seed and scale only
+    if (!QFile::exists(xmageArchive))
+    {
+        ArchiveGenerator generator(seed, scale);
+        err << "Generating " << xmageArchive << Qt::endl;
+        // Written under a temporary name so an interrupted run is not reused
+        if (!generator.xmage(xmageArchive + ".part") || !QFile::rename(xmageArchive + ".part", xmageArchive))
+        {
+            err << generator.errorString() << Qt::endl;
+            return 1;
+        }
+    }
+    if (!QFile::exists(decksArchive))
+    {
+        ArchiveGenerator generator(seed + 1, scale);
+        err << "Generating " << decksArchive << Qt::endl;
+        if (!generator.decks(decksArchive + ".part") || !QFile::rename(decksArchive + ".part", decksArchive))
+        {
+            err << generator.errorString() << Qt::endl;
+            return 1;
+        }
+    }
+
+    // Same owned directories as DownloadManager::managedDirs()
+    QStringList managedDirs = QStringList() << "mage-client/lib" << "mage-client/db"
+                                            << "mage-server/lib" << "mage-server/db";
+    QString dest = workDir + "/out";
+
+    struct Scenario
+    {
+        QString name;
+        QString archive;
+        // Runs before the timer starts, after the output was cleared
+        std::function<bool(QString *)> prepare;
+        std::function<bool(QString *)> run;
+    };
+    QList<Scenario> scenarios;
+    scenarios.append(Scenario{ "xmage/unzip", xmageArchive, nullptr, [&](QString *error) {
+                                   return runUnzip(xmageArchive, dest, true, managedDirs, false, error);
+                               } });
+    scenarios.append(Scenario{ "xmage/unzip-unchanged", xmageArchive,
+                               [&](QString *error) { return runUnzip(xmageArchive, dest, true, managedDirs, true, error); },
+                               [&](QString *error) {
+                                   return runUnzip(xmageArchive, dest, true, managedDirs, true, error);
+                               } });
+    scenarios.append(Scenario{ "xmage/stream", xmageArchive, nullptr,
+                               [&](QString *error) { return runStream(xmageArchive, dest, managedDirs, error); } });
+    scenarios.append(Scenario{ "decks/unzip", decksArchive, nullptr, [&](QString *error) {
+                                   return runUnzip(decksArchive, dest, false, QStringList(), false, error);
+                               } });
+    scenarios.append(Scenario{ "decks/stream", decksArchive, nullptr,
+                               [&](QString *error) { return runStream(decksArchive, dest, QStringList(), error); } });
+
+    int failures = 0;
+    for (const Scenario &scenario : std::as_const(scenarios))
+    {
+        if (!filter.isEmpty() && !scenario.name.contains(filter))
+        {
+            continue;
+        }
+        for (int run = 1; run <= repeat; run++)
+        {
+            QDir(dest).removeRecursively();
+            QDir().mkpath(dest);
+            QString error;
+            if (scenario.prepare && !scenario.prepare(&error))
+            {
+                err << scenario.name << ": " << error << Qt::endl;
+                failures++;
+                break;
+            }
+
+            ProcessCounters::resetPeakRss();
+            ProcessCounters before = ProcessCounters::sample();
+            QElapsedTimer timer;
+            timer.start();
+            bool ok = scenario.run(&error);
+            double seconds = timer.nsecsElapsed() / 1e9;
+            ProcessCounters after = ProcessCounters::sample();
+            if (!ok)
+            {
+                err << scenario.name << ": " << error << Qt::endl;
+                failures++;
+                break;
+            }
+
+            qint64 files = 0;
+            qint64 bytes = 0;
+            countTree(dest, &files, &bytes);
+            QJsonObject result;
+            result.insert("scenario", scenario.name);
+            result.insert("run", run);
+            result.insert("inflate", Inflater::backendName(Inflater::defaultBackend()));
+            result.insert("archive_bytes", QFileInfo(scenario.archive).size());
+            result.insert("files", files);
+            result.insert("bytes", bytes);
+            result.insert("seconds", seconds);
+            result.insert("mb_per_s", bytes / (1024.0 * 1024.0) / seconds);
+            result.insert("files_per_s", files / seconds);
+            ProcessCounters::insertDelta(before, after, &result);
+            out << QJsonDocument(result).toJson(QJsonDocument::Compact) << Qt::endl;
+        }
+    }
+    QDir(dest).removeRecursively();
+    return failures == 0 ? 0 : 1;
+}
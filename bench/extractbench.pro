@@ -0,0 +1,55 @@
+# Headless extraction benchmark, built separately from the launcher:
+#   mkdir build-bench && cd build-bench && qmake6 ../bench/extractbench.pro && make
+#   ./extractbench --scale 0.25 > results.jsonl
+# Add CONFIG+=libdeflate to qmake to compare --inflate zlib and libdeflate.
+
+QT = core
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = extractbench
+INCLUDEPATH += ../src
+
+SOURCES += \
+    archivegenerator.cpp \
+    extractbench.cpp \
+    processcounters.cpp \
+    ../src/inflater.cpp \
+    ../src/installfilter.cpp \
+    ../src/installindex.cpp \
+    ../src/installswap.cpp \
+    ../src/streamextractthread.cpp \
+    ../src/unzipthread.cpp \
+    ../src/zipdirectory.cpp \
+    ../src/zipstreamthread.cpp
+
+HEADERS += \
+    archivegenerator.h \
+    processcounters.h \
+    ../src/inflater.h \
+    ../src/installfilter.h \
+    ../src/installindex.h \
+    ../src/installswap.h \
+    ../src/streamextractthread.h \
+    ../src/unzipthread.h \
+    ../src/zipdirectory.h \
+    ../src/zipstreamthread.h
+
+libdeflate {
+    DEFINES += USE_LIBDEFLATE
+    macx: INCLUDEPATH += /opt/homebrew/opt/libdeflate/include
+    macx: LIBS += -L/opt/homebrew/opt/libdeflate/lib
+    LIBS += -ldeflate
+}
+
+macx {
+    INCLUDEPATH += /opt/homebrew/opt/libzip/include
+    LIBS += -L/opt/homebrew/opt/libzip/lib -lzip -lz
+}
+linux {
+    LIBS += -lzip -lz
+}
+win32 {
+    LIBS += -lzip -lz -lbz2 -llzma
+}
@@ -0,0 +1,248 @@
+// Process log stress benchmark. Starts a copy of itself that prints a given
+// amount of log-like UTF-8 text as fast as it can, shows the output the way
+// the launcher does and prints one JSON object per run on stdout:
+//
+//   {"mode":"pipeline","run":1,"mb":100,"lines":...,"seconds":...,"mb_per_s":...,
+//    "held_lines":...,"paints":...,"max_stall_ms":...,"peak_rss_kb":...,...}
+//
+// max_stall_ms is the longest the GUI thread went without running its event
+// loop, measured with a timer. "pipeline" is the launcher's reader thread,
+// ring buffer and LogView; "plaintext" appends every chunk to a
+// QPlainTextEdit on the GUI thread, for comparison. --session-log also saves
+// the pipeline's output to disk as a client session would. Needs a display,
+// or QT_QPA_PLATFORM=offscreen.
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QPlainTextEdit>
+#include <QProcess>
+#include <QTextStream>
+#include <QTimer>
+#include <cstdio>
+#include <cstring>
+#include "logbuffer.h"
+#include "logview.h"
+#include "processcounters.h"
+#include "xmageprocess.h"
+
+// Odd-sized writes, so multi-byte sequences and line ends get cut
+#define LOG_BENCH_WRITE_SIZE 65521
+#define LOG_BENCH_TICK_INTERVAL 10
+
+// Child side: lines of varying length with two- and three-byte characters,
+// then "END <number of lines before it>"
+static int emitOutput(qint64 megabytes)
+{
+    qint64 target = megabytes * 1024 * 1024;
+    qint64 written = 0;
+    qint64 lines = 0;
+    QByteArray pending;
+    while (written + pending.size() < target)
+    {
+        pending += QString("%1 INFO  Game %2: turn %3 — Übergröße casts Ætherize ✓ 日本語 %4\n")
+                       .arg(lines)
+                       .arg(lines % 977)
+                       .arg(lines % 31)
+                       .arg(QString(static_cast<int>(lines % 97), QChar('x')))
+                       .toUtf8();
+        lines++;
+        while (pending.size() >= LOG_BENCH_WRITE_SIZE)
+        {
+            fwrite(pending.constData(), 1, LOG_BENCH_WRITE_SIZE, stdout);
+            fflush(stdout);
+            written += LOG_BENCH_WRITE_SIZE;
+            pending.remove(0, LOG_BENCH_WRITE_SIZE);
+        }
+    }
+    pending += QString("END %1\n").arg(lines).toUtf8();
+    fwrite(pending.constData(), 1, pending.size(), stdout);
+    fflush(stdout);
+    return 0;
+}
+
+struct RunResult
+{
+    qint64 lines = 0;
+    qint64 heldLines = 0;
+    qint64 paints = 0;
+    bool complete = false; // Saw the END line with the right count
+    bool clean = true;     // No U+FFFD, so no sequence was split wrongly
+};
+
+static void checkLines(const QStringList &held, qint64 total, RunResult *result)
+{
+    result->complete = !held.isEmpty() && held.last() == QString("END %1").arg(total - 1);
+    for (const QString &line : held)
+    {
+        if (line.contains(QChar::ReplacementCharacter))
+        {
+            result->clean = false;
+            break;
+        }
+    }
+}
+
+static RunResult runPipeline(const QStringList &childArguments, const QString &sessionLogDir)
+{
+    LogBuffer buffer;
+    LogView view;
+    view.setBuffer(&buffer);
+    view.resize(601, 371);
+    view.show();
+
+    QEventLoop loop;
+    XMageProcess *process = new XMageProcess(&buffer);
+    if (!sessionLogDir.isEmpty())
+    {
+        process->setSessionLog(sessionLogDir, "logbench");
+    }
+    QObject::connect(process, &XMageProcess::finished, &loop, &QEventLoop::quit);
+    process->start(QCoreApplication::applicationFilePath(), childArguments);
+    loop.exec();
+    // Let the last frame through, as a user would see it
+    QTimer::singleShot(2 * LOG_VIEW_FRAME_INTERVAL, &loop, &QEventLoop::quit);
+    loop.exec();
+
+    RunResult result;
+    result.lines = buffer.end();
+    result.heldLines = buffer.end() - buffer.first();
+    result.paints = view.paintCount();
+    checkLines(buffer.lines(buffer.first(), buffer.end()), result.lines, &result);
+    return result;
+}
+
+static RunResult runPlainText(const QStringList &childArguments)
+{
+    QPlainTextEdit console;
+    console.setReadOnly(true);
+    console.resize(601, 371);
+    console.show();
+
+    QEventLoop loop;
+    QProcess process;
+    QObject::connect(&process, &QProcess::readyReadStandardOutput, [&]() {
+        console.appendPlainText(process.readAllStandardOutput());
+    });
+    QObject::connect(&process, &QProcess::finished, &loop, &QEventLoop::quit);
+    process.start(QCoreApplication::applicationFilePath(), childArguments);
+    loop.exec();
+    console.appendPlainText(process.readAllStandardOutput());
+
+    // appendPlainText() starts a new block per chunk, so count lines in the text
+    QStringList lines = console.toPlainText().split('\n', Qt::SkipEmptyParts);
+    RunResult result;
+    result.lines = lines.size();
+    result.heldLines = lines.size();
+    result.paints = -1;
+    checkLines(lines, result.lines, &result);
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    // The child only prints; it must not need a display
+    for (int i = 1; i + 1 < argc; i++)
+    {
+        if (strcmp(argv[i], "--emit") == 0)
+        {
+            return emitOutput(QByteArray(argv[i + 1]).toLongLong());
+        }
+    }
+
+    QApplication app(argc, argv);
+    QCoreApplication::setApplicationName("logbench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Measures how the launcher copes with a child process printing a lot of output.");
+    parser.addHelpOption();
+    QCommandLineOption sizeOption("size", "Megabytes of output the child prints (default 100).", "mb", "100");
+    QCommandLineOption repeatOption("repeat", "Runs per mode (default 3).", "count", "3");
+    QCommandLineOption modeOption("mode", "pipeline, plaintext or both (default pipeline).", "mode", "pipeline");
+    QCommandLineOption sessionLogOption("session-log", "Also save pipeline output to session logs in dir.", "dir");
+    QCommandLineOption emitOption("emit", "Internal: print this many megabytes and exit.", "mb");
+    parser.addOptions({ sizeOption, repeatOption, modeOption, sessionLogOption, emitOption });
+    parser.process(app);
+
+    qint64 megabytes = qMax(1LL, parser.value(sizeOption).toLongLong());
+    int repeat = qMax(1, parser.value(repeatOption).toInt());
+    QString mode = parser.value(modeOption);
+    QString sessionLogDir = parser.value(sessionLogOption);
+    QStringList modes;
+    if (mode == "both")
+    {
+        modes << "pipeline" << "plaintext";
+    }
+    else if (mode == "pipeline" || mode == "plaintext")
+    {
+        modes << mode;
+    }
+    else
+    {
+        QTextStream(stderr) << "Unknown mode: " << mode << Qt::endl;
+        return 2;
+    }
+    QStringList childArguments = QStringList() << "--emit" << QString::number(megabytes);
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    // Ticks that come late show how long the GUI thread was busy
+    QElapsedTimer tickClock;
+    qint64 lastTick = 0;
+    qint64 maxStall = 0;
+    QTimer ticker;
+    ticker.setInterval(LOG_BENCH_TICK_INTERVAL);
+    QObject::connect(&ticker, &QTimer::timeout, [&]() {
+        qint64 now = tickClock.elapsed();
+        maxStall = qMax(maxStall, now - lastTick - LOG_BENCH_TICK_INTERVAL);
+        lastTick = now;
+    });
+
+    int failures = 0;
+    for (const QString &name : std::as_const(modes))
+    {
+        for (int run = 1; run <= repeat; run++)
+        {
+            ProcessCounters::resetPeakRss();
+            ProcessCounters before = ProcessCounters::sample();
+            maxStall = 0;
+            lastTick = 0;
+            tickClock.start();
+            ticker.start();
+            QElapsedTimer timer;
+            timer.start();
+            RunResult result = name == "pipeline" ? runPipeline(childArguments, sessionLogDir) : runPlainText(childArguments);
+            double seconds = timer.nsecsElapsed() / 1e9;
+            ticker.stop();
+            ProcessCounters after = ProcessCounters::sample();
+
+            // The old approach breaks lines at chunk boundaries and decodes
+            // each chunk on its own, so its output is reported, not required
+            // to be right
+            if (name == "pipeline" && (!result.complete || !result.clean))
+            {
+                err << name << ": output was " << (result.complete ? "garbled" : "incomplete") << Qt::endl;
+                failures++;
+            }
+            QJsonObject json;
+            json.insert("mode", name);
+            json.insert("run", run);
+            json.insert("mb", megabytes);
+            json.insert("lines", result.lines);
+            json.insert("seconds", seconds);
+            json.insert("mb_per_s", megabytes / seconds);
+            json.insert("held_lines", result.heldLines);
+            json.insert("paints", result.paints);
+            json.insert("max_stall_ms", maxStall);
+            json.insert("session_log", name == "pipeline" && !sessionLogDir.isEmpty());
+            json.insert("complete", result.complete);
+            json.insert("clean", result.clean);
+            ProcessCounters::insertDelta(before, after, &json);
+            out << QJsonDocument(json).toJson(QJsonDocument::Compact) << Qt::endl;
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
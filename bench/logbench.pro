@@ -0,0 +1,39 @@
+# Process log stress benchmark, built separately from the launcher:
+#   mkdir build-logbench && cd build-logbench && qmake6 ../bench/logbench.pro && make
+#   QT_QPA_PLATFORM=offscreen ./logbench --size 100 --mode both > results.jsonl
+
+QT = core gui widgets
+
+CONFIG += c++17
+CONFIG -= app_bundle
+
+TARGET = logbench
+INCLUDEPATH += ../src
+
+SOURCES += \
+    logbench.cpp \
+    processcounters.cpp \
+    ../src/linesplitter.cpp \
+    ../src/logbuffer.cpp \
+    ../src/logview.cpp \
+    ../src/sessionlogwriter.cpp \
+    ../src/xmageprocess.cpp
+
+HEADERS += \
+    processcounters.h \
+    ../src/linesplitter.h \
+    ../src/logbuffer.h \
+    ../src/logview.h \
+    ../src/sessionlogwriter.h \
+    ../src/xmageprocess.h
+
+macx {
+    INCLUDEPATH += /opt/homebrew/opt/zstd/include
+    LIBS += -L/opt/homebrew/opt/zstd/lib -lzstd
+}
+linux {
+    LIBS += -lzstd
+}
+win32 {
+    LIBS += -lzstd
+}
@@ -0,0 +1,82 @@
+#include "processcounters.h"
+#include <QFile>
+#include <QHash>
+#if defined(Q_OS_UNIX)
+#include <sys/resource.h>
+#endif
+
+static QHash<QByteArray, qint64> readProcFile(const QString &fileName)
+{
+    QHash<QByteArray, qint64> values;
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return values;
+    }
+    for (const QByteArray &line : file.readAll().split('\n'))
+    {
+        int colon = line.indexOf(':');
+        if (colon > 0)
+        {
+            // "VmHWM:	  123456 kB" and "syscr: 1234" alike
+            values.insert(line.left(colon), line.mid(colon + 1).trimmed().split(' ').first().toLongLong());
+        }
+    }
+    return values;
+}
+
+void ProcessCounters::resetPeakRss()
+{
+#if defined(Q_OS_LINUX)
+    // "5" resets VmHWM to the current RSS
+    QFile clearRefs("/proc/self/clear_refs");
+    if (clearRefs.open(QIODevice::WriteOnly))
+    {
+        clearRefs.write("5");
+    }
+#endif
+}
+
+ProcessCounters ProcessCounters::sample()
+{
+    ProcessCounters counters;
+#if defined(Q_OS_LINUX)
+    QHash<QByteArray, qint64> io = readProcFile("/proc/self/io");
+    counters.syscallsRead = io.value("syscr", -1);
+    counters.syscallsWrite = io.value("syscw", -1);
+    counters.bytesRead = io.value("read_bytes", -1);
+    counters.bytesWritten = io.value("write_bytes", -1);
+    counters.peakRssKb = readProcFile("/proc/self/status").value("VmHWM", 0);
+#endif
+#if defined(Q_OS_UNIX)
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    counters.userSeconds = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6;
+    counters.systemSeconds = usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+    counters.contextSwitches = usage.ru_nvcsw + usage.ru_nivcsw;
+    if (counters.peakRssKb == 0)
+    {
+#if defined(Q_OS_MACOS)
+        counters.peakRssKb = usage.ru_maxrss / 1024; // Bytes on macOS
+#else
+        counters.peakRssKb = usage.ru_maxrss;
+#endif
+    }
+#endif
+    return counters;
+}
+
+void ProcessCounters::insertDelta(const ProcessCounters &before, const ProcessCounters &after, QJsonObject *result)
+{
+    result->insert("cpu_user_s", after.userSeconds - before.userSeconds);
+    result->insert("cpu_system_s", after.systemSeconds - before.systemSeconds);
+    result->insert("context_switches", after.contextSwitches - before.contextSwitches);
+    if (before.syscallsRead >= 0)
+    {
+        result->insert("syscalls_read", after.syscallsRead - before.syscallsRead);
+        result->insert("syscalls_write", after.syscallsWrite - before.syscallsWrite);
+        result->insert("disk_read_bytes", after.bytesRead - before.bytesRead);
+        result->insert("disk_write_bytes", after.bytesWritten - before.bytesWritten);
+    }
+    result->insert("peak_rss_kb", after.peakRssKb);
+}
@@ -0,0 +1,29 @@
+#ifndef PROCESSCOUNTERS_H
+#define PROCESSCOUNTERS_H
+
+#include <QJsonObject>
+#include <QtGlobal>
+
+// Resource usage of this process, sampled before and after a benchmark run.
+// Syscall and disk byte counts come from /proc/self/io and are only
+// available on Linux (-1 elsewhere). Peak RSS is reset by resetPeakRss()
+// where the kernel allows it (Linux), otherwise it is the process peak so
+// far.
+struct ProcessCounters
+{
+    qint64 syscallsRead = -1;
+    qint64 syscallsWrite = -1;
+    qint64 bytesRead = -1;
+    qint64 bytesWritten = -1;
+    double userSeconds = 0;
+    double systemSeconds = 0;
+    qint64 contextSwitches = 0;
+    qint64 peakRssKb = 0;
+
+    static ProcessCounters sample();
+    static void resetPeakRss();
+    // Adds the differences from before to result, plus after's peak RSS
+    static void insertDelta(const ProcessCounters &before, const ProcessCounters &after, QJsonObject *result);
+};
+
+#endif // PROCESSCOUNTERS_H
@@ -0,0 +1,199 @@
+#include "diskwriterthread.h"
+#include <iterator>
+#include <limits>
+
+DiskWriterThread::DiskWriterThread(const QString &fileName, bool hashing)
+    : hash(QCryptographicHash::Sha256)
+{
+    this->fileName = fileName;
+    this->hashing = hashing;
+}
+
+void DiskWriterThread::write(qint64 offset, QByteArray data)
+{
+    QMutexLocker locker(&mutex);
+    queuedBytes += data.size();
+    chunks.enqueue(Chunk{offset, data});
+    dataAvailable.wakeOne();
+}
+
+qint64 DiskWriterThread::space()
+{
+    QMutexLocker locker(&mutex);
+    qint64 room = qMax<qint64>(0, DISK_WRITER_BUFFER_SIZE - queuedBytes);
+    if (room == 0)
+    {
+        full = true;
+    }
+    return room;
+}
+
+void DiskWriterThread::markWritten(qint64 offset, qint64 size)
+{
+    QMutexLocker locker(&mutex);
+    addExtent(offset, size);
+}
+
+qint64 DiskWriterThread::writtenFrom(qint64 offset)
+{
+    QMutexLocker locker(&mutex);
+    auto it = extents.upperBound(offset);
+    if (it == extents.begin())
+    {
+        return 0;
+    }
+    --it;
+    return it.value() > offset ? it.value() - offset : 0;
+}
+
+void DiskWriterThread::finish()
+{
+    QMutexLocker locker(&mutex);
+    inputFinished = true;
+    dataAvailable.wakeOne();
+}
+
+void DiskWriterThread::abort()
+{
+    QMutexLocker locker(&mutex);
+    aborted = true;
+    dataAvailable.wakeOne();
+}
+
+QByteArray DiskWriterThread::digest() const
+{
+    return result;
+}
+
+qint64 DiskWriterThread::hashedBytes() const
+{
+    return hashed;
+}
+
+void DiskWriterThread::addExtent(qint64 offset, qint64 size)
+{
+    if (size <= 0)
+    {
+        return;
+    }
+    qint64 start = offset;
+    qint64 end = offset + size;
+    auto it = extents.upperBound(start);
+    if (it != extents.begin())
+    {
+        auto previous = std::prev(it);
+        if (previous.value() >= start)
+        {
+            start = previous.key();
+            end = qMax(end, previous.value());
+            extents.erase(previous);
+        }
+    }
+    it = extents.lowerBound(start);
+    while (it != extents.end() && it.key() <= end)
+    {
+        end = qMax(end, it.value());
+        it = extents.erase(it);
+    }
+    extents.insert(start, end);
+}
+
+bool DiskWriterThread::advanceHash(QFile &file, qint64 budget)
+{
+    // Segments arrive out of order, so read back whatever other segments
+    // wrote just past the hashed prefix
+    while (budget > 0)
+    {
+        qint64 available = writtenFrom(hashed);
+        if (available == 0)
+        {
+            return true;
+        }
+        if (!file.seek(hashed))
+        {
+            return false;
+        }
+        QByteArray data = file.read(qMin(qMin(available, budget), static_cast<qint64>(DISK_WRITER_HASH_CATCHUP)));
+        if (data.isEmpty())
+        {
+            return false;
+        }
+        hash.addData(data);
+        hashed += data.size();
+        budget -= data.size();
+    }
+    return true;
+}
+
+void DiskWriterThread::run()
+{
+    // Unbuffered, so whatever writtenFrom() reports has reached the OS
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadWrite | QIODevice::Unbuffered))
+    {
+        emit write_fail("Failed to open file " + fileName);
+        return;
+    }
+
+    while (true)
+    {
+        Chunk chunk;
+        {
+            QMutexLocker locker(&mutex);
+            while (chunks.isEmpty() && !inputFinished && !aborted)
+            {
+                dataAvailable.wait(&mutex);
+            }
+            if (aborted)
+            {
+                return;
+            }
+            if (chunks.isEmpty())
+            {
+                break; // Input finished and fully written
+            }
+            chunk = chunks.dequeue();
+        }
+
+        if (!file.seek(chunk.offset) || file.write(chunk.data) != chunk.data.size())
+        {
+            emit write_fail("Error writing to file " + fileName);
+            return;
+        }
+        if (hashing && chunk.offset == hashed)
+        {
+            hash.addData(chunk.data);
+            hashed += chunk.data.size();
+        }
+
+        bool wake = false;
+        {
+            QMutexLocker locker(&mutex);
+            addExtent(chunk.offset, chunk.data.size());
+            queuedBytes -= chunk.data.size();
+            if (full && queuedBytes <= DISK_WRITER_BUFFER_SIZE / 2)
+            {
+                full = false;
+                wake = true;
+            }
+        }
+        if (wake)
+        {
+            emit space_available();
+        }
+        if (hashing && !advanceHash(file, DISK_WRITER_HASH_CATCHUP))
+        {
+            emit write_fail("Error reading back file " + fileName);
+            return;
+        }
+    }
+
+    if (hashing && !advanceHash(file, std::numeric_limits<qint64>::max()))
+    {
+        emit write_fail("Error reading back file " + fileName);
+        return;
+    }
+    result = hash.result().toHex();
+    file.close();
+    emit write_complete();
+}
@@ -0,0 +1,76 @@
+#ifndef DISKWRITERTHREAD_H
+#define DISKWRITERTHREAD_H
+
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QFile>
+#include <QMap>
+#include <QMutex>
+#include <QQueue>
+#include <QString>
+#include <QThread>
+#include <QWaitCondition>
+
+#define DISK_WRITER_BUFFER_SIZE (8 * 1024 * 1024)
+#define DISK_WRITER_HASH_CATCHUP (4 * 1024 * 1024)
+
+// Writes downloaded data to a file, and optionally hashes it, on its own
+// thread so a slow disk never stalls the GUI. write() queues a chunk for
+// an offset; no more than DISK_WRITER_BUFFER_SIZE bytes are queued at a
+// time. Callers read from the network only as much as space() allows and
+// otherwise wait for space_available(), leaving the rest in the replies'
+// bounded read buffers so TCP slows the sender down.
+//
+// The SHA-256 follows the contiguous prefix of the file written so far,
+// reading back data written ahead of it. write(), space(), writtenFrom(),
+// finish() and abort() may be called from any thread.
+class DiskWriterThread : public QThread
+{
+    Q_OBJECT
+public:
+    DiskWriterThread(const QString &fileName, bool hashing);
+    void run() override;
+
+    void write(qint64 offset, QByteArray data);
+    qint64 space();
+    // Records data already in the file (a resumed download); call before start()
+    void markWritten(qint64 offset, qint64 size);
+    // Bytes on disk starting at offset without a gap
+    qint64 writtenFrom(qint64 offset);
+    void finish();
+    void abort();
+    // Valid after write_complete()
+    QByteArray digest() const;
+    qint64 hashedBytes() const;
+
+signals:
+    void space_available();
+    void write_complete();
+    void write_fail(QString errorMessage);
+
+private:
+    struct Chunk
+    {
+        qint64 offset;
+        QByteArray data;
+    };
+
+    QString fileName;
+    bool hashing;
+    QMutex mutex;
+    QWaitCondition dataAvailable;
+    QQueue<Chunk> chunks;
+    qint64 queuedBytes = 0;
+    bool full = false;
+    bool inputFinished = false;
+    bool aborted = false;
+    QMap<qint64, qint64> extents; // Start -> end (exclusive) of written data
+    QCryptographicHash hash;
+    qint64 hashed = 0;
+    QByteArray result;
+
+    void addExtent(qint64 offset, qint64 size);
+    bool advanceHash(QFile &file, qint64 budget);
+};
+
+#endif // DISKWRITERTHREAD_H
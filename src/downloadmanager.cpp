@@ -1,32 +1,33 @@
 #include "downloadmanager.h"
 #include "unzipthread.h"
 
-DownloadManager::DownloadManager(QString downloadLocation, MainWindow *mainWindow)
+DownloadManager::DownloadManager(QString downloadLocation, NetworkService *network, MainWindow *mainWindow)
     : QObject(mainWindow)
-    , networkManager(new QNetworkAccessManager(this))
 {
     this->downloadLocation = downloadLocation;
+    this->network = network;
     this->mainWindow = mainWindow;
 }
 
 DownloadManager::~DownloadManager()
 {
-    if (saveFile != nullptr)
+    if (stream != nullptr)
     {
-        delete saveFile;
+        disconnect(stream, nullptr, this, nullptr);
+        stream->abort();
+        stream->wait();
+    }
+    if (download != nullptr)
+    {
+        delete download;
     }
-    delete networkManager;
 }
 
 void DownloadManager::downloadXmage(QString configUrl)
 {
-    connect(networkManager, &QNetworkAccessManager::finished, this, &DownloadManager::poll_config);
     mainWindow->log("Fetching XMage version info from " + configUrl + "...");
-    QUrl url(configUrl);
-    QNetworkRequest request(url);
-    request.setAttribute(QNetworkRequest::RedirectPolicyAttribute,
-                         QNetworkRequest::NoLessSafeRedirectPolicy);
-    networkManager->get(request);
+    QNetworkReply *reply = network->get(network->request(QUrl(configUrl)));
+    connect(reply, &QNetworkReply::finished, this, &DownloadManager::poll_config);
 }
 
 void DownloadManager::downloadXmageFromUrl(const QString &url, const QString &version)
@@ -36,19 +37,63 @@ void DownloadManager::downloadXmageFromUrl(const QString &url, const QString &ve
     startDownload(QUrl(url), nullptr);
 }
 
-void DownloadManager::poll_config(QNetworkReply *reply)
+void DownloadManager::setExpectedSha256(const QByteArray &hexDigest)
+{
+    expectedSha256 = hexDigest;
+}
+
+void DownloadManager::setMirrors(const QList<QUrl> &mirrors)
+{
+    this->mirrors = mirrors;
+}
+
+void DownloadManager::setFilter(const InstallFilter &filter)
 {
+    this->filter = filter;
+}
+
+void DownloadManager::setUpVerification()
+{
+    download->setMirrors(mirrors);
+    if (!expectedSha256.isEmpty())
+    {
+        download->setExpectedSha256(expectedSha256);
+    }
+    else
+    {
+        download->setChecksumUrl(QUrl(downloadUrl.toString() + ".sha256"));
+    }
+}
+
+bool DownloadManager::tarArchive() const
+{
+    return TarStreamThread::isTarArchive(downloadUrl.fileName());
+}
+
+QStringList DownloadManager::managedDirs()
+{
+    // Directories fully owned by the build; anything else (settings, images,
+    // plugins the user added) is left alone on update
+    return QStringList() << "mage-client/lib" << "mage-client/db"
+                         << "mage-server/lib" << "mage-server/db";
+}
+
+void DownloadManager::poll_config()
+{
+    QNetworkReply *reply = qobject_cast<QNetworkReply *>(sender());
     if (reply->error() != QNetworkReply::NoError)
     {
         pollFailed(reply, "Network error: " + reply->errorString());
     }
     else
     {
-        QJsonObject xmageInfo = QJsonDocument::fromJson(reply->readAll()).object().value("XMage").toObject();
+        QJsonObject xmageInfo = MainWindow::xmageBuildInfo(QJsonDocument::fromJson(reply->readAll()).object());
         QUrl url(xmageInfo.value("full").toString());
         if (url.isValid())
         {
             xmageVersion = xmageInfo.value("version").toString();
+            expectedSha256 = xmageInfo.value("sha256").toString().toLatin1();
+            mirrors = FileDownload::urlList(xmageInfo.value("mirrors"));
             if (xmageVersion.isEmpty())
             {
                 xmageVersion = "xmage";
@@ -76,87 +121,140 @@ void DownloadManager::startDownload(QUrl url, QNetworkReply *reply)
 {
     mainWindow->log("Found XMage version: " + xmageVersion);
 
-    QString fileName;
+    fileName.clear();
     if (!downloadLocation.isEmpty())
     {
         QDir().mkpath(downloadLocation);
         fileName.append(downloadLocation + '/');
     }
-    fileName.append("xmage.zip");
+    downloadUrl = url;
+    // The tar decoder sniffs the compression, so the local name need not
+    // carry it
+    fileName.append(tarArchive() ? "xmage.tar" : "xmage.zip");
 
-    saveFile = new QSaveFile(fileName);
-    if (!saveFile->open(QIODevice::WriteOnly))
+    // A journaled partial download is cheaper to resume than to stream
+    // again, and a verified local archive needs no download at all
+    if (QFile::exists(fileName + ".part.json") || (!expectedSha256.isEmpty() && QFile::exists(fileName)))
     {
-        pollFailed(reply, "Failed to create file " + saveFile->fileName());
-        delete saveFile;
-        saveFile = nullptr;
+        startFileDownload();
     }
     else
     {
-        mainWindow->log("Downloading XMage from " + url.toString());
-        networkManager->disconnect();
-        connect(networkManager, &QNetworkAccessManager::finished, this, &DownloadManager::download_complete);
-        QNetworkRequest request(url);
-        request.setAttribute(QNetworkRequest::RedirectPolicyAttribute,
-                             QNetworkRequest::NoLessSafeRedirectPolicy);
-        downloadReply = networkManager->get(request);
-        connect(downloadReply, &QNetworkReply::downloadProgress, mainWindow, &MainWindow::update_progress_bar);
-        connect(downloadReply, &QNetworkReply::readyRead, this, &DownloadManager::save_data);
-        if (reply)
-        {
-            reply->deleteLater();
-        }
+        startStreamingDownload();
     }
-}
-
-void DownloadManager::save_data()
-{
-    if (!saveFile->write(downloadReply->readAll()))
+    if (reply)
     {
-        mainWindow->download_fail("Error writing to file " + saveFile->fileName());
-        delete saveFile;
-        saveFile = nullptr;
-        downloadReply->deleteLater();
-        this->deleteLater();
+        reply->deleteLater();
     }
 }
 
-void DownloadManager::download_complete(QNetworkReply *reply)
+void DownloadManager::startStreamingDownload()
 {
-    QString errorMessage;
-    QString fileName(saveFile->fileName());
-    if (reply->error() != QNetworkReply::NoError)
+    mainWindow->log("Downloading and extracting XMage from " + downloadUrl.toString());
+    if (tarArchive())
     {
-        errorMessage = "Network error: " + reply->errorString();
+        stream = new TarStreamThread(downloadLocation, true, managedDirs());
     }
     else
     {
-        saveFile->write(reply->readAll());
-        if (saveFile->commit())
-        {
-            mainWindow->log("Download complete");
-        }
-        else
-        {
-            errorMessage = "Error writing to file " + fileName;
-        }
+        stream = new ZipStreamThread(downloadLocation, managedDirs());
+    }
+    stream->setFilter(filter);
+    connect(stream, &StreamExtractThread::log, mainWindow, &MainWindow::log);
+    connect(stream, &StreamExtractThread::extract_complete, this, &DownloadManager::stream_complete);
+    connect(stream, &StreamExtractThread::extract_fail, this, &DownloadManager::stream_failed);
+    connect(stream, &StreamExtractThread::finished, stream, &QObject::deleteLater);
+
+    download = new FileDownload(network, downloadUrl, fileName, this);
+    download->setStreamConsumer(stream);
+    setUpVerification();
+    mainWindow->getProgressTracker()->addStage(download, "Downloading and extracting XMage");
+    connect(download, &FileDownload::log, mainWindow, &MainWindow::log);
+    connect(download, &FileDownload::progress, mainWindow->getProgressTracker(), &ProgressTracker::update);
+    connect(download, &FileDownload::throughput, mainWindow, &MainWindow::update_throughput);
+    connect(download, &FileDownload::download_fail, this, &DownloadManager::download_failed);
+    stream->start();
+    download->start();
+}
+
+void DownloadManager::startFileDownload()
+{
+    mainWindow->log("Downloading XMage from " + downloadUrl.toString());
+    download = new FileDownload(network, downloadUrl, fileName, this);
+    setUpVerification();
+    mainWindow->getProgressTracker()->addStage(download, "Downloading XMage");
+    connect(download, &FileDownload::log, mainWindow, &MainWindow::log);
+    connect(download, &FileDownload::progress, mainWindow->getProgressTracker(), &ProgressTracker::update);
+    connect(download, &FileDownload::throughput, mainWindow, &MainWindow::update_throughput);
+    connect(download, &FileDownload::download_complete, this, &DownloadManager::download_complete);
+    connect(download, &FileDownload::download_fail, this, &DownloadManager::download_failed);
+    download->start();
+}
+
+void DownloadManager::download_failed(QString errorMessage)
+{
+    if (stream != nullptr)
+    {
+        disconnect(stream, nullptr, this, nullptr);
+        stream->abort();
+        stream = nullptr;
     }
-    delete saveFile;
-    saveFile = nullptr;
-    reply->deleteLater();
+    mainWindow->download_fail(errorMessage);
+    this->deleteLater();
+}
+
+void DownloadManager::stream_complete(QString installLocation)
+{
+    stream = nullptr;
+    mainWindow->update_throughput(QString());
+    mainWindow->download_success(installLocation);
     this->deleteLater();
-    if (errorMessage.isEmpty())
+}
+
+void DownloadManager::stream_failed(QString errorMessage)
+{
+    // Archives the stream parser cannot handle still install the slow way
+    stream = nullptr;
+    mainWindow->log(errorMessage);
+    mainWindow->log("Streaming extraction failed, downloading the full archive instead");
+    if (download != nullptr)
     {
-        UnzipThread *unzip = new UnzipThread(fileName, downloadLocation);
-        connect(unzip, &UnzipThread::log, mainWindow, &MainWindow::log);
-        connect(unzip, &UnzipThread::progress, mainWindow, &MainWindow::update_progress_bar);
-        connect(unzip, &UnzipThread::unzip_fail, mainWindow, &MainWindow::download_fail);
-        connect(unzip, &UnzipThread::unzip_complete, mainWindow, &MainWindow::download_success);
-        connect(unzip, &UnzipThread::finished, unzip, &QObject::deleteLater);
-        unzip->start();
+        delete download;
+        download = nullptr;
     }
-    else
+    startFileDownload();
+}
+
+void DownloadManager::download_complete(QString fileName)
+{
+    mainWindow->log("Download complete");
+    mainWindow->update_throughput(QString());
+    this->deleteLater();
+
+    if (tarArchive())
     {
-        mainWindow->download_fail(errorMessage);
+        TarStreamThread *untar = new TarStreamThread(downloadLocation, true, managedDirs());
+        untar->setSourceFile(fileName);
+        untar->setFilter(filter);
+        connect(untar, &TarStreamThread::log, mainWindow, &MainWindow::log);
+        mainWindow->getProgressTracker()->addStage(untar, "Extracting XMage");
+        connect(untar, &TarStreamThread::progress, mainWindow->getProgressTracker(), &ProgressTracker::update);
+        connect(untar, &TarStreamThread::extract_fail, mainWindow, &MainWindow::download_fail);
+        connect(untar, &TarStreamThread::extract_complete, mainWindow, &MainWindow::download_success);
+        connect(untar, &TarStreamThread::finished, untar, &QObject::deleteLater);
+        untar->start();
+        return;
     }
+
+    UnzipThread *unzip = new UnzipThread(fileName, downloadLocation, true, managedDirs());
+    // Most jars are identical between releases; only the changed ones are written
+    unzip->setIncremental(true);
+    unzip->setFilter(filter);
+    connect(unzip, &UnzipThread::log, mainWindow, &MainWindow::log);
+    mainWindow->getProgressTracker()->addStage(unzip, "Extracting XMage");
+    connect(unzip, &UnzipThread::progress, mainWindow->getProgressTracker(), &ProgressTracker::update);
+    connect(unzip, &UnzipThread::unzip_fail, mainWindow, &MainWindow::download_fail);
+    connect(unzip, &UnzipThread::unzip_complete, mainWindow, &MainWindow::download_success);
+    connect(unzip, &UnzipThread::finished, unzip, &QObject::deleteLater);
+    unzip->start();
 }
@@ -6,36 +6,54 @@
 #include <QJsonObject>
 #include <QString>
 #include <QDir>
-#include <QtNetwork/QNetworkAccessManager>
 #include <QtNetwork/QNetworkRequest>
 #include <QtNetwork/QNetworkReply>
+#include "filedownload.h"
 #include "mainwindow.h"
+#include "networkservice.h"
+#include "tarstreamthread.h"
+#include "zipstreamthread.h"
 
 class DownloadManager : public QObject
 {
     Q_OBJECT
 
 public:
-    DownloadManager(QString downloadLocation, MainWindow *mainWindow);
+    DownloadManager(QString downloadLocation, NetworkService *network, MainWindow *mainWindow);
     ~DownloadManager();
     void downloadXmage(QString configUrl);
     void downloadXmageFromUrl(const QString &url, const QString &version);
+    void setExpectedSha256(const QByteArray &hexDigest);
+    void setMirrors(const QList<QUrl> &mirrors);
+    void setFilter(const InstallFilter &filter);
+    static QStringList managedDirs();
 
 private:
     QString downloadLocation;
     QString xmageVersion;
     MainWindow *mainWindow;
-    QNetworkAccessManager *networkManager;
-    QNetworkReply *downloadReply;
-    QSaveFile *saveFile = nullptr;
+    NetworkService *network;
+    FileDownload *download = nullptr;
+    StreamExtractThread *stream = nullptr;
+    QUrl downloadUrl;
+    QByteArray expectedSha256;
+    QList<QUrl> mirrors;
+    InstallFilter filter;
+    QString fileName;
 
     void pollFailed(QNetworkReply *reply, QString errorMessage);
     void startDownload(QUrl url, QNetworkReply *reply);
+    void startStreamingDownload();
+    void startFileDownload();
+    void setUpVerification();
+    bool tarArchive() const;
 
 private slots:
-    void poll_config(QNetworkReply *reply);
-    void download_complete(QNetworkReply *reply);
-    void save_data();
+    void poll_config();
+    void download_complete(QString fileName);
+    void download_failed(QString errorMessage);
+    void stream_complete(QString installLocation);
+    void stream_failed(QString errorMessage);
 };
 
 #endif // DOWNLOADMANAGER_H
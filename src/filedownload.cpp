@@ -0,0 +1,983 @@
+#include "filedownload.h"
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QFileInfo>
+#include <QSaveFile>
+
+FileDownload::FileDownload(NetworkService *network, const QUrl &url, const QString &fileName, QObject *parent)
+    : QObject(parent)
+    , hash(QCryptographicHash::Sha256)
+    , throughputTimer(new QTimer(this))
+{
+    this->network = network;
+    this->url = url;
+    this->resolvedUrl = url;
+    this->targetFileName = fileName;
+    throughputTimer->setInterval(DOWNLOAD_THROUGHPUT_INTERVAL);
+    connect(throughputTimer, &QTimer::timeout, this, &FileDownload::report_throughput);
+}
+
+FileDownload::~FileDownload()
+{
+    abortAll();
+    endTransfer();
+    if (partFile != nullptr)
+    {
+        // Launcher closing mid-download: remember how far we got
+        saveJournal();
+        stopWriter();
+        delete partFile;
+    }
+}
+
+void FileDownload::setMaxSegments(int maxSegments)
+{
+    this->maxSegments = qMax(1, maxSegments);
+}
+
+void FileDownload::setStreamConsumer(StreamExtractThread *consumer)
+{
+    this->consumer = consumer;
+    this->streaming = true;
+    connect(this, &FileDownload::data_received, consumer, &StreamExtractThread::feed, Qt::DirectConnection);
+    connect(this, &FileDownload::download_complete, consumer, &StreamExtractThread::finish, Qt::DirectConnection);
+    connect(consumer, &StreamExtractThread::space_available, this, &FileDownload::tokens_available);
+}
+
+void FileDownload::setExpectedSha256(const QByteArray &hexDigest)
+{
+    this->expectedSha256 = hexDigest.trimmed().toLower();
+}
+
+void FileDownload::setChecksumUrl(const QUrl &checksumUrl)
+{
+    this->checksumUrl = checksumUrl;
+}
+
+void FileDownload::setMirrors(const QList<QUrl> &mirrors)
+{
+    this->mirrors = mirrors;
+}
+
+QList<QUrl> FileDownload::urlList(const QJsonValue &value, const QString &suffix)
+{
+    QList<QUrl> urls;
+    const QJsonArray array = value.toArray();
+    for (const QJsonValue &item : array)
+    {
+        QUrl itemUrl(item.toString() + suffix);
+        if (!item.toString().isEmpty() && itemUrl.isValid())
+        {
+            urls.append(itemUrl);
+        }
+    }
+    return urls;
+}
+
+void FileDownload::setPriority(TransferScheduler::Priority priority)
+{
+    this->priority = priority;
+    if (transferId != 0)
+    {
+        network->scheduler()->setPriority(transferId, priority);
+    }
+}
+
+QString FileDownload::fileName() const
+{
+    return targetFileName;
+}
+
+QString FileDownload::journalFileName() const
+{
+    return targetFileName + ".part.json";
+}
+
+bool FileDownload::canResume() const
+{
+    return rangesSupported && totalSize > 0 && (!etag.isEmpty() || !lastModified.isEmpty());
+}
+
+QNetworkRequest FileDownload::makeRequest(const QUrl &requestUrl) const
+{
+    return network->request(requestUrl);
+}
+
+void FileDownload::start()
+{
+    downloadClock.start();
+    if (expectedSha256.isEmpty() && checksumUrl.isValid())
+    {
+        QNetworkReply *reply = network->get(makeRequest(checksumUrl));
+        connect(reply, &QNetworkReply::finished, this, &FileDownload::checksum_finished);
+        return;
+    }
+    startTransfer();
+}
+
+void FileDownload::checksum_finished()
+{
+    QNetworkReply *reply = qobject_cast<QNetworkReply *>(sender());
+    reply->deleteLater();
+
+    // sha256sum format: the digest is the first word
+    QByteArray digest = reply->readAll().trimmed().split(' ').value(0).split('\t').value(0).toLower();
+    if (reply->error() == QNetworkReply::NoError && digest.size() == 64 &&
+        !QByteArray::fromHex(digest).isEmpty())
+    {
+        expectedSha256 = digest;
+    }
+    else
+    {
+        emit log("Download: no checksum published at " + checksumUrl.toString() + ", skipping verification");
+    }
+    startTransfer();
+}
+
+bool FileDownload::cachedFileMatches()
+{
+    QFile file(targetFileName);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+    QCryptographicHash fileHash(QCryptographicHash::Sha256);
+    return fileHash.addData(&file) && fileHash.result().toHex() == expectedSha256;
+}
+
+void FileDownload::startTransfer()
+{
+    if (!streaming && !expectedSha256.isEmpty() && cachedFileMatches())
+    {
+        emit log("Download: " + QFileInfo(targetFileName).fileName() + " is already here and matches its checksum");
+        QTimer::singleShot(0, this, [this]() {
+            qint64 size = QFileInfo(targetFileName).size();
+            emit progress(size, size);
+            emit download_complete(targetFileName);
+        });
+        return;
+    }
+
+    transferId = network->scheduler()->addTransfer(priority);
+    connect(network->scheduler(), &TransferScheduler::tokens_available, this, &FileDownload::tokens_available);
+
+    // Probe with HEAD first: we need the size and range support before we
+    // know how many connections to open. Mirrors are probed at the same time
+    // and the first answer, i.e. the lowest connect + first-byte time, wins.
+    sources.clear();
+    probed = false;
+    probeClock.start();
+    const QList<QUrl> candidates = QList<QUrl>() << url << mirrors;
+    for (const QUrl &candidate : candidates)
+    {
+        QNetworkReply *probe = network->head(makeRequest(candidate));
+        probes.append(probe);
+        connect(probe, &QNetworkReply::finished, this, &FileDownload::probe_finished);
+    }
+}
+
+void FileDownload::probe_finished()
+{
+    QNetworkReply *probe = qobject_cast<QNetworkReply *>(sender());
+    probe->deleteLater();
+    probes.removeOne(probe);
+
+    if (probe->error() == QNetworkReply::NoError)
+    {
+        bool ok = false;
+        qint64 length = probe->header(QNetworkRequest::ContentLengthHeader).toLongLong(&ok);
+        length = (ok && length > 0) ? length : -1;
+        bool ranges = probe->rawHeader("Accept-Ranges").contains("bytes");
+        if (!probed)
+        {
+            probed = true;
+            // Segment requests go straight to the final location instead of
+            // following the same redirect chain once per connection
+            resolvedUrl = probe->url();
+            sources.append(resolvedUrl);
+            rangesSupported = ranges;
+            totalSize = length;
+            etag = QString::fromLatin1(probe->rawHeader("ETag"));
+            lastModified = QString::fromLatin1(probe->rawHeader("Last-Modified"));
+            if (!mirrors.isEmpty())
+            {
+                emit log(QString("Download: using %1 (answered in %2 ms)")
+                             .arg(resolvedUrl.host())
+                             .arg(probeClock.elapsed()));
+            }
+            beginTransfer();
+        }
+        else if (ranges && rangesSupported && length == totalSize && totalSize > 0)
+        {
+            // Only a mirror with the same size and range support can take
+            // over a transfer part way through
+            sources.append(probe->url());
+            emit log(QString("Download: mirror %1 answered in %2 ms")
+                         .arg(probe->url().host())
+                         .arg(probeClock.elapsed()));
+        }
+        return;
+    }
+
+    if (!probed && probes.isEmpty())
+    {
+        // Some servers reject HEAD; a plain GET still works
+        probed = true;
+        emit log("Download: probe failed (" + probe->errorString() + "), using a single connection");
+        sources.append(resolvedUrl);
+        rangesSupported = false;
+        totalSize = -1;
+        beginTransfer();
+    }
+}
+
+void FileDownload::beginTransfer()
+{
+    if (streaming)
+    {
+        segments.clear();
+        // Requested as a range when possible, so a dropped connection
+        // continues from where it broke off instead of from the first byte
+        qint64 end = (rangesSupported && totalSize > 0) ? totalSize - 1 : -1;
+        segments.append(Segment{0, end, 0, 0, nullptr});
+        startPendingSegments();
+        return;
+    }
+
+    partFile = new QFile(targetFileName + ".part");
+    if (resumeFromJournal())
+    {
+        startPendingSegments();
+        return;
+    }
+    if (!partFile->open(QIODevice::ReadWrite | QIODevice::Truncate))
+    {
+        fail("Failed to create file " + partFile->fileName());
+        return;
+    }
+    // The writer thread opens its own handle
+    partFile->close();
+    startSegments();
+}
+
+bool FileDownload::resumeFromJournal()
+{
+    QFile journal(journalFileName());
+    if (!journal.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+    QJsonObject root = QJsonDocument::fromJson(journal.readAll()).object();
+    journal.close();
+
+    // Only trust the partial file if the server still serves the same bytes
+    QString journalEtag = root.value("etag").toString();
+    QString journalLastModified = root.value("lastModified").toString();
+    bool sameFile = root.value("url").toString() == url.toString() &&
+                    root.value("size").toInteger(-1) == totalSize &&
+                    (etag.isEmpty() ? (!lastModified.isEmpty() && journalLastModified == lastModified)
+                                    : journalEtag == etag);
+    if (!sameFile || !canResume() || !partFile->exists())
+    {
+        emit log("Download: discarding stale partial download");
+        QFile::remove(journalFileName());
+        return false;
+    }
+
+    segments.clear();
+    qint64 resumed = 0;
+    const QJsonArray segmentArray = root.value("segments").toArray();
+    for (const QJsonValue &val : segmentArray)
+    {
+        QJsonObject obj = val.toObject();
+        qint64 start = obj.value("start").toInteger();
+        qint64 end = obj.value("end").toInteger(-1);
+        qint64 received = obj.value("received").toInteger();
+        if (end < 0)
+        {
+            // A single stream interrupted part way can continue as a range
+            end = totalSize - 1;
+        }
+        if (start < 0 || received < 0 || end >= totalSize || start + received > end + 1 ||
+            start + received > partFile->size())
+        {
+            segments.clear();
+            break;
+        }
+        segments.append(Segment{start, end, received, received, nullptr});
+        resumed += received;
+    }
+    if (segments.isEmpty())
+    {
+        QFile::remove(journalFileName());
+        return false;
+    }
+
+    emit log(QString("Resuming download at %1 MB of %2 MB")
+                 .arg(resumed / 1048576.0, 0, 'f', 1)
+                 .arg(totalSize / 1048576.0, 0, 'f', 1));
+    emit progress(resumed, totalSize);
+    return true;
+}
+
+void FileDownload::saveJournal()
+{
+    if (!canResume() || writer == nullptr)
+    {
+        return;
+    }
+
+    QJsonArray segmentArray;
+    for (const Segment &segment : segments)
+    {
+        // Only what has reached the disk, not what is still queued
+        QJsonObject obj;
+        obj.insert("start", segment.start);
+        obj.insert("end", segment.end);
+        obj.insert("received", qMin(segment.received, writer->writtenFrom(segment.start)));
+        segmentArray.append(obj);
+    }
+    QJsonObject root;
+    root.insert("url", url.toString());
+    root.insert("etag", etag);
+    root.insert("lastModified", lastModified);
+    root.insert("size", totalSize);
+    root.insert("segments", segmentArray);
+
+    QSaveFile journal(journalFileName());
+    if (journal.open(QIODevice::WriteOnly))
+    {
+        journal.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+        journal.commit();
+    }
+}
+
+void FileDownload::startSegments()
+{
+    segments.clear();
+    stopWriter();
+    hash.reset();
+    hashedBytes = 0;
+    int count = 1;
+    if (rangesSupported && totalSize > 0)
+    {
+        count = static_cast<int>(qBound<qint64>(1, totalSize / DOWNLOAD_MIN_SEGMENT_SIZE, maxSegments));
+    }
+
+    if (count > 1)
+    {
+        // Reserve the whole file up front so segments can write at their offsets
+        partFile->resize(totalSize);
+        qint64 segmentSize = totalSize / count;
+        for (int i = 0; i < count; i++)
+        {
+            qint64 start = i * segmentSize;
+            qint64 end = (i == count - 1) ? totalSize - 1 : start + segmentSize - 1;
+            segments.append(Segment{start, end, 0, 0, nullptr});
+        }
+        emit log(QString("Downloading over %1 connections").arg(count));
+    }
+    else
+    {
+        partFile->resize(0);
+        segments.append(Segment{0, -1, 0, 0, nullptr});
+    }
+    startPendingSegments();
+}
+
+void FileDownload::startPendingSegments()
+{
+    if (!streaming && writer == nullptr)
+    {
+        startWriter();
+    }
+    bool pending = false;
+    for (int i = 0; i < segments.size(); i++)
+    {
+        const Segment &segment = segments[i];
+        if (segment.end < 0 || segment.received < segment.end - segment.start + 1)
+        {
+            startSegment(i);
+            pending = true;
+        }
+    }
+    if (!pending)
+    {
+        finishDownload();
+        return;
+    }
+    throughputClock.start();
+    throughputTimer->start();
+}
+
+QNetworkRequest FileDownload::segmentRequest(const Segment &segment, int source, qint64 offset) const
+{
+    QNetworkRequest request = makeRequest(sources.value(source, resolvedUrl));
+    if (segment.end >= 0)
+    {
+        request.setRawHeader("Range", QString("bytes=%1-%2").arg(offset).arg(segment.end).toLatin1());
+        if (offset > 0 && source == 0)
+        {
+            // If the file changed since the journal was written the server
+            // answers 200 with the full body and we start over. Weak ETags
+            // are not allowed in If-Range, and the validators only hold for
+            // the source they came from.
+            QString validator = etag.startsWith("W/") || etag.isEmpty() ? lastModified : etag;
+            if (!validator.isEmpty())
+            {
+                request.setRawHeader("If-Range", validator.toLatin1());
+            }
+        }
+    }
+    if (segments.size() > 1)
+    {
+        // Over HTTP/2 the segments would share one connection and its
+        // congestion window, which defeats the point of splitting
+        request.setAttribute(QNetworkRequest::Http2AllowedAttribute, false);
+    }
+    return request;
+}
+
+void FileDownload::startSegment(int index)
+{
+    Segment &segment = segments[index];
+    segment.reply = network->get(segmentRequest(segment, segment.source, segment.start + segment.received));
+    segment.replyFinished = false;
+    segment.idleTicks = 0;
+    // Bounded so that data we are not allowed to read yet backs up into TCP
+    segment.reply->setReadBufferSize(TRANSFER_READ_BUFFER_SIZE);
+    connect(segment.reply, &QNetworkReply::readyRead, this, &FileDownload::segment_ready_read);
+    connect(segment.reply, &QNetworkReply::finished, this, &FileDownload::segment_finished);
+}
+
+int FileDownload::segmentIndex(QNetworkReply *reply) const
+{
+    for (int i = 0; i < segments.size(); i++)
+    {
+        if (segments[i].reply == reply)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int FileDownload::hedgeIndex(QNetworkReply *reply) const
+{
+    for (int i = 0; i < segments.size(); i++)
+    {
+        if (segments[i].hedge == reply)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool FileDownload::failOver(int index, const QString &reason)
+{
+    Segment &segment = segments[index];
+    qint64 offset = segment.start + segment.received;
+    if (segment.hedge != nullptr && segment.hedgeOffset == offset)
+    {
+        // Already asked another mirror for exactly this data
+        promoteHedge(index);
+        return true;
+    }
+    // Data fed to a consumer cannot be fetched again, so a stream also
+    // retries its only source; a file download resumes from its journal
+    if ((sources.size() < 2 && !streaming) || segment.end < 0 || failovers >= DOWNLOAD_MAX_FAILOVERS)
+    {
+        return false;
+    }
+
+    failovers++;
+    discardReply(segment.reply);
+    discardReply(segment.hedge);
+    segment.reply = nullptr;
+    segment.hedge = nullptr;
+    int next = (segment.source + 1) % sources.size();
+    emit log(QString("Download: %1 failed (%2), continuing at byte %3 from %4")
+                 .arg(sources[segment.source].host(), reason)
+                 .arg(offset)
+                 .arg(sources[next].host()));
+    segment.source = next;
+    startSegment(index);
+    return true;
+}
+
+void FileDownload::startHedge(int index)
+{
+    Segment &segment = segments[index];
+    segment.hedgeSource = (segment.source + 1) % sources.size();
+    segment.hedgeOffset = segment.start + segment.received;
+    emit log(QString("Download: no data from %1, also asking %2")
+                 .arg(sources[segment.source].host(), sources[segment.hedgeSource].host()));
+    segment.hedge = network->get(segmentRequest(segment, segment.hedgeSource, segment.hedgeOffset));
+    segment.hedge->setReadBufferSize(TRANSFER_READ_BUFFER_SIZE);
+    connect(segment.hedge, &QNetworkReply::readyRead, this, &FileDownload::hedge_ready_read);
+    connect(segment.hedge, &QNetworkReply::finished, this, &FileDownload::hedge_finished);
+}
+
+void FileDownload::promoteHedge(int index)
+{
+    Segment &segment = segments[index];
+    discardReply(segment.reply);
+    disconnect(segment.hedge, nullptr, this, nullptr);
+    segment.reply = segment.hedge;
+    segment.source = segment.hedgeSource;
+    segment.hedge = nullptr;
+    segment.replyFinished = false;
+    segment.idleTicks = 0;
+    connect(segment.reply, &QNetworkReply::readyRead, this, &FileDownload::segment_ready_read);
+    connect(segment.reply, &QNetworkReply::finished, this, &FileDownload::segment_finished);
+    if (segment.reply->isFinished())
+    {
+        segment.replyFinished = true;
+    }
+}
+
+void FileDownload::discardReply(QNetworkReply *reply)
+{
+    if (reply != nullptr)
+    {
+        disconnect(reply, nullptr, this, nullptr);
+        reply->abort();
+        reply->deleteLater();
+    }
+}
+
+void FileDownload::hedge_ready_read()
+{
+    int index = hedgeIndex(qobject_cast<QNetworkReply *>(sender()));
+    if (index < 0 || segments[index].hedge->bytesAvailable() == 0)
+    {
+        return;
+    }
+    Segment &segment = segments[index];
+    if (segment.start + segment.received != segment.hedgeOffset)
+    {
+        // The original connection recovered in the meantime
+        discardReply(segment.hedge);
+        segment.hedge = nullptr;
+        return;
+    }
+    emit log("Download: switching to " + sources[segment.hedgeSource].host());
+    promoteHedge(index);
+    writeSegmentData(index);
+}
+
+void FileDownload::hedge_finished()
+{
+    QNetworkReply *reply = qobject_cast<QNetworkReply *>(sender());
+    int index = hedgeIndex(reply);
+    if (index < 0)
+    {
+        reply->deleteLater();
+        return;
+    }
+    Segment &segment = segments[index];
+    if (reply->error() != QNetworkReply::NoError || segment.start + segment.received != segment.hedgeOffset)
+    {
+        discardReply(segment.hedge);
+        segment.hedge = nullptr;
+        return;
+    }
+    promoteHedge(index);
+    completeSegment(index);
+}
+
+qint64 FileDownload::bytesReceived() const
+{
+    qint64 total = 0;
+    for (const Segment &segment : segments)
+    {
+        total += segment.received;
+    }
+    return total;
+}
+
+bool FileDownload::writeSegmentData(int index)
+{
+    Segment &segment = segments[index];
+    QNetworkReply *reply = segment.reply;
+    int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    // A lone range from the first byte is answered in full by some servers
+    bool wholeBody = status == 200 && segments.size() == 1 &&
+                     reply->request().rawHeader("Range").startsWith("bytes=0-");
+    if (segment.end >= 0 && status != 206 && !wholeBody)
+    {
+        if (streaming)
+        {
+            // Data already handed out cannot be taken back
+            fail("Network error: " + reply->url().host() + " ignored the range request");
+            return false;
+        }
+        if (reply->request().hasRawHeader("If-Range"))
+        {
+            // The file changed since a partial download was journaled; the
+            // server still serves ranges
+            startOver();
+            return false;
+        }
+        // The server advertised ranges but sent the whole body anyway
+        fallBackToSingleStream();
+        return false;
+    }
+
+    // Whatever the writer or consumer has no room for stays in the reply's
+    // bounded buffer
+    qint64 wanted = reply->bytesAvailable();
+    if (writer != nullptr)
+    {
+        wanted = qMin(wanted, writer->space());
+    }
+    if (consumer != nullptr)
+    {
+        wanted = qMin(wanted, consumer->space());
+    }
+    QByteArray data = reply->read(network->scheduler()->acquire(transferId, wanted));
+    if (segment.end >= 0)
+    {
+        // Never write past the end of our range, even if the server does
+        qint64 remaining = segment.end - segment.start + 1 - segment.received;
+        if (data.size() > remaining)
+        {
+            data.truncate(remaining);
+        }
+    }
+    else if (totalSize < 0)
+    {
+        bool ok = false;
+        qint64 length = reply->header(QNetworkRequest::ContentLengthHeader).toLongLong(&ok);
+        if (ok && length > 0)
+        {
+            totalSize = length;
+        }
+    }
+    if (data.isEmpty())
+    {
+        return true;
+    }
+
+    if (streaming)
+    {
+        if (!expectedSha256.isEmpty())
+        {
+            hash.addData(data);
+            hashedBytes += data.size();
+        }
+        segment.received += data.size();
+        emit data_received(data);
+        reportProgress();
+        return true;
+    }
+    writer->write(segment.start + segment.received, data);
+    segment.received += data.size();
+    reportProgress();
+    return true;
+}
+
+void FileDownload::segment_ready_read()
+{
+    int index = segmentIndex(qobject_cast<QNetworkReply *>(sender()));
+    if (index >= 0)
+    {
+        writeSegmentData(index);
+    }
+}
+
+void FileDownload::segment_finished()
+{
+    QNetworkReply *reply = qobject_cast<QNetworkReply *>(sender());
+    int index = segmentIndex(reply);
+    if (index < 0)
+    {
+        reply->deleteLater();
+        return;
+    }
+
+    if (reply->error() != QNetworkReply::NoError)
+    {
+        if (!failOver(index, reply->errorString()))
+        {
+            fail("Network error: " + reply->errorString());
+        }
+        return;
+    }
+    segments[index].replyFinished = true;
+    completeSegment(index);
+}
+
+void FileDownload::completeSegment(int index)
+{
+    if (!writeSegmentData(index))
+    {
+        return;
+    }
+
+    Segment &segment = segments[index];
+    QNetworkReply *reply = segment.reply;
+    if (reply->bytesAvailable() > 0)
+    {
+        // Throttled: the rest is read as the scheduler hands out tokens
+        return;
+    }
+    segment.reply = nullptr;
+    reply->deleteLater();
+    if (segment.end >= 0 && segment.received != segment.end - segment.start + 1)
+    {
+        if (failOver(index, "connection closed early"))
+        {
+            return;
+        }
+        fail(QString("Network error: connection closed after %1 of %2 bytes")
+                 .arg(segment.received)
+                 .arg(segment.end - segment.start + 1));
+        return;
+    }
+
+    discardReply(segment.hedge);
+    segment.hedge = nullptr;
+    for (const Segment &other : segments)
+    {
+        if (other.reply != nullptr)
+        {
+            return;
+        }
+    }
+    finishDownload();
+}
+
+bool FileDownload::checkDigest(const QByteArray &actual, qint64 hashed)
+{
+    if (expectedSha256.isEmpty())
+    {
+        return true;
+    }
+    if (hashed == bytesReceived() && actual == expectedSha256)
+    {
+        emit log("Download: SHA-256 verified");
+        return true;
+    }
+    // Corrupt data must not be resumed: without validators fail() drops
+    // the partial file and its journal
+    etag.clear();
+    lastModified.clear();
+    fail("Checksum mismatch: expected " + QString::fromLatin1(expectedSha256) + ", got " + QString::fromLatin1(actual));
+    return false;
+}
+
+void FileDownload::startWriter()
+{
+    writer = new DiskWriterThread(partFile->fileName(), !expectedSha256.isEmpty());
+    for (const Segment &segment : segments)
+    {
+        writer->markWritten(segment.start, segment.received);
+    }
+    connect(writer, &DiskWriterThread::space_available, this, &FileDownload::tokens_available);
+    connect(writer, &DiskWriterThread::write_complete, this, &FileDownload::write_complete);
+    connect(writer, &DiskWriterThread::write_fail, this, &FileDownload::write_failed);
+    writer->start();
+}
+
+void FileDownload::stopWriter()
+{
+    if (writer != nullptr)
+    {
+        disconnect(writer, nullptr, this, nullptr);
+        writer->abort();
+        writer->wait();
+        delete writer;
+        writer = nullptr;
+    }
+}
+
+void FileDownload::reportProgress()
+{
+    // Capped so a fast transfer does not flood the GUI thread with updates
+    if (progressClock.isValid() && progressClock.elapsed() < DOWNLOAD_PROGRESS_INTERVAL)
+    {
+        return;
+    }
+    progressClock.start();
+    emit progress(bytesReceived(), totalSize);
+}
+
+void FileDownload::tokens_available()
+{
+    for (int i = 0; i < segments.size() && transferId != 0; i++)
+    {
+        if (segments[i].reply == nullptr)
+        {
+            continue;
+        }
+        if (segments[i].replyFinished)
+        {
+            completeSegment(i);
+        }
+        else if (!writeSegmentData(i))
+        {
+            return;
+        }
+    }
+}
+
+void FileDownload::endTransfer()
+{
+    if (transferId != 0)
+    {
+        disconnect(network->scheduler(), nullptr, this, nullptr);
+        network->scheduler()->removeTransfer(transferId);
+        transferId = 0;
+    }
+}
+
+void FileDownload::fallBackToSingleStream()
+{
+    emit log("Download: server ignored range request, restarting on a single connection");
+    abortAll();
+    rangesSupported = false;
+    QFile::remove(journalFileName());
+    startSegments();
+}
+
+void FileDownload::startOver()
+{
+    emit log("Download: the file changed since the partial download, starting over");
+    abortAll();
+    stopWriter();
+    QFile::remove(journalFileName());
+    partFile->remove();
+    delete partFile;
+    partFile = nullptr;
+    endTransfer();
+    // Probed again for the new size and validators
+    startTransfer();
+}
+
+void FileDownload::abortAll()
+{
+    for (Segment &segment : segments)
+    {
+        discardReply(segment.reply);
+        discardReply(segment.hedge);
+        segment.reply = nullptr;
+        segment.hedge = nullptr;
+    }
+    for (QNetworkReply *probe : std::as_const(probes))
+    {
+        discardReply(probe);
+    }
+    probes.clear();
+    throughputTimer->stop();
+}
+
+void FileDownload::fail(const QString &errorMessage)
+{
+    abortAll();
+    if (partFile != nullptr)
+    {
+        if (canResume() && writer != nullptr)
+        {
+            saveJournal();
+            stopWriter();
+            emit log(QString("Keeping %1 MB of partial download for the next attempt")
+                         .arg(bytesReceived() / 1048576.0, 0, 'f', 1));
+        }
+        else
+        {
+            stopWriter();
+            partFile->remove();
+            QFile::remove(journalFileName());
+        }
+    }
+    endTransfer();
+    emit download_fail(errorMessage);
+}
+
+void FileDownload::finishDownload()
+{
+    throughputTimer->stop();
+    emit progress(bytesReceived(), totalSize);
+    if (streaming)
+    {
+        if (!checkDigest(hash.result().toHex(), hashedBytes))
+        {
+            return;
+        }
+        endTransfer();
+        emit download_complete(QString());
+        return;
+    }
+    // The last chunks may still be queued; write_complete() follows
+    writer->finish();
+}
+
+void FileDownload::write_failed(QString errorMessage)
+{
+    fail(errorMessage);
+}
+
+void FileDownload::write_complete()
+{
+    writer->wait();
+    QByteArray actual = writer->digest();
+    qint64 hashed = writer->hashedBytes();
+    delete writer;
+    writer = nullptr;
+    if (!checkDigest(actual, hashed))
+    {
+        return;
+    }
+    endTransfer();
+    QFile::remove(journalFileName());
+
+    QFile::remove(targetFileName);
+    if (!partFile->rename(targetFileName))
+    {
+        fail("Error renaming " + partFile->fileName() + " to " + targetFileName);
+        return;
+    }
+
+    qint64 elapsed = qMax<qint64>(1, downloadClock.elapsed());
+    qint64 received = bytesReceived();
+    emit log(QString("Downloaded %1 MB in %2 s (%3 MB/s over %4 connection%5)")
+                 .arg(received / 1048576.0, 0, 'f', 1)
+                 .arg(elapsed / 1000.0, 0, 'f', 1)
+                 .arg(received / 1048576.0 / (elapsed / 1000.0), 0, 'f', 1)
+                 .arg(segments.size())
+                 .arg(segments.size() == 1 ? "" : "s"));
+    emit download_complete(targetFileName);
+}
+
+void FileDownload::report_throughput()
+{
+    saveJournal();
+
+    qint64 elapsed = throughputClock.restart();
+    if (elapsed <= 0)
+    {
+        return;
+    }
+
+    QStringList rates;
+    for (int i = 0; i < segments.size(); i++)
+    {
+        Segment &segment = segments[i];
+        double rate = (segment.received - segment.lastReceived) * 1000.0 / elapsed / 1048576.0;
+        // Data held back by the scheduler is not a stall
+        bool idle = segment.reply != nullptr && !segment.replyFinished &&
+                    segment.received == segment.lastReceived && segment.reply->bytesAvailable() == 0;
+        segment.idleTicks = idle ? segment.idleTicks + 1 : 0;
+        segment.lastReceived = segment.received;
+        rates << QString::number(rate, 'f', 1);
+        if (segment.idleTicks >= DOWNLOAD_STALL_TICKS && segment.hedge == nullptr &&
+            segment.end >= 0 && sources.size() > 1)
+        {
+            startHedge(i);
+        }
+    }
+    emit throughput(rates.join(" | ") + " MB/s");
+}
@@ -0,0 +1,171 @@
+#ifndef FILEDOWNLOAD_H
+#define FILEDOWNLOAD_H
+
+#include <QCryptographicHash>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonValue>
+#include <QList>
+#include <QPointer>
+#include <QString>
+#include <QTimer>
+#include <QUrl>
+#include <QtNetwork/QNetworkReply>
+#include <QtNetwork/QNetworkRequest>
+#include "diskwriterthread.h"
+#include "networkservice.h"
+#include "streamextractthread.h"
+
+#define DOWNLOAD_MAX_SEGMENTS 4
+#define DOWNLOAD_MIN_SEGMENT_SIZE (8 * 1024 * 1024)
+#define DOWNLOAD_THROUGHPUT_INTERVAL 1000
+#define DOWNLOAD_PROGRESS_INTERVAL 100
+// Throughput samples without progress before a segment is hedged
+#define DOWNLOAD_STALL_TICKS 5
+#define DOWNLOAD_MAX_FAILOVERS 8
+
+// Downloads a single URL to a file. When the server advertises byte ranges
+// the file is split into up to maxSegments ranges fetched over parallel
+// connections, each written at its own offset; otherwise it falls back to
+// one sequential stream.
+//
+// Data goes to <fileName>.part through a DiskWriterThread, with a <fileName>.part.json journal of the
+// URL, validators and per-segment progress. A later download of the same
+// URL picks up from the journal as long as the ETag/Last-Modified match.
+//
+// With a stream consumer nothing is written to disk: the body is fetched
+// over one connection and fed to the consumer in order, reading from the
+// network only as much as the consumer's space() allows. A connection that
+// drops is continued with a range request from the current offset, on a
+// mirror if there is one, so the stream never starts over.
+//
+// With an expected SHA-256 (given directly or read from a sidecar file) the
+// digest is computed as data arrives and a mismatch fails the download
+// before download_complete(). A finished file that already matches the
+// digest is used without touching the network.
+//
+// Mirrors serving the same file are probed together with the main URL and
+// the first to answer is used. The others become failover sources: a
+// segment whose connection fails continues from its current offset on the
+// next one, and a segment that stalls gets a hedged request on another
+// mirror, keeping whichever connection delivers first.
+class FileDownload : public QObject
+{
+    Q_OBJECT
+public:
+    FileDownload(NetworkService *network, const QUrl &url, const QString &fileName, QObject *parent = nullptr);
+    ~FileDownload();
+    void setMaxSegments(int maxSegments);
+    // Feeds the body to consumer and calls its finish() once verified
+    void setStreamConsumer(StreamExtractThread *consumer);
+    void setPriority(TransferScheduler::Priority priority);
+    void setExpectedSha256(const QByteArray &hexDigest);
+    // Where to look for "<hex digest>  <file>" when no digest was given
+    void setChecksumUrl(const QUrl &checksumUrl);
+    void setMirrors(const QList<QUrl> &mirrors);
+    void start();
+    QString fileName() const;
+    QString journalFileName() const;
+    // URLs from a JSON array of strings, each with suffix appended
+    static QList<QUrl> urlList(const QJsonValue &value, const QString &suffix = QString());
+
+signals:
+    void log(QString message);
+    void progress(qint64 bytesReceived, qint64 bytesTotal);
+    void throughput(QString summary);
+    void data_received(QByteArray data);
+    void download_complete(QString fileName);
+    void download_fail(QString errorMessage);
+
+private:
+    struct Segment
+    {
+        qint64 start;
+        qint64 end;          // Inclusive; -1 for an open-ended single stream
+        qint64 received;
+        qint64 lastReceived; // Value of received at the previous throughput sample
+        QNetworkReply *reply;
+        bool replyFinished = false; // Finished, but paced data is still buffered
+        int source = 0;              // Index into sources
+        int idleTicks = 0;
+        QNetworkReply *hedge = nullptr;
+        int hedgeSource = 0;
+        qint64 hedgeOffset = 0;
+    };
+
+    NetworkService *network;
+    QUrl url;
+    QUrl resolvedUrl;
+    QList<QUrl> mirrors;
+    QList<QUrl> sources; // Probed locations, fastest first
+    QList<QNetworkReply *> probes;
+    QElapsedTimer probeClock;
+    bool probed = false;
+    int failovers = 0;
+    QString targetFileName;
+    QFile *partFile = nullptr;
+    QList<Segment> segments;
+    qint64 totalSize = -1;
+    int maxSegments = DOWNLOAD_MAX_SEGMENTS;
+    bool rangesSupported = false;
+    bool streaming = false;
+    QPointer<StreamExtractThread> consumer;
+    TransferScheduler::Priority priority = TransferScheduler::Interactive;
+    QUrl checksumUrl;
+    QByteArray expectedSha256;
+    DiskWriterThread *writer = nullptr;
+    QCryptographicHash hash; // Streaming mode; the writer hashes files
+    qint64 hashedBytes = 0;
+    int transferId = 0;
+    QString etag;
+    QString lastModified;
+    QTimer *throughputTimer;
+    QElapsedTimer throughputClock;
+    QElapsedTimer downloadClock;
+    QElapsedTimer progressClock;
+
+    QNetworkRequest makeRequest(const QUrl &requestUrl) const;
+    void startTransfer();
+    void beginTransfer();
+    bool cachedFileMatches();
+    bool checkDigest(const QByteArray &actual, qint64 hashed);
+    void startWriter();
+    void stopWriter();
+    void reportProgress();
+    bool canResume() const;
+    bool resumeFromJournal();
+    void saveJournal();
+    void startSegments();
+    void startPendingSegments();
+    QNetworkRequest segmentRequest(const Segment &segment, int source, qint64 offset) const;
+    void startSegment(int index);
+    bool failOver(int index, const QString &reason);
+    void startHedge(int index);
+    void promoteHedge(int index);
+    void discardReply(QNetworkReply *reply);
+    bool writeSegmentData(int index);
+    void completeSegment(int index);
+    void endTransfer();
+    void fallBackToSingleStream();
+    void startOver();
+    void abortAll();
+    void fail(const QString &errorMessage);
+    void finishDownload();
+    qint64 bytesReceived() const;
+    int segmentIndex(QNetworkReply *reply) const;
+    int hedgeIndex(QNetworkReply *reply) const;
+
+private slots:
+    void checksum_finished();
+    void probe_finished();
+    void segment_ready_read();
+    void segment_finished();
+    void hedge_ready_read();
+    void hedge_finished();
+    void tokens_available();
+    void write_complete();
+    void write_failed(QString errorMessage);
+    void report_throughput();
+};
+
+#endif // FILEDOWNLOAD_H
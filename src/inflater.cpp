@@ -0,0 +1,132 @@
+#include "inflater.h"
+#include <atomic>
+#include <climits>
+#include <cstring>
+#include <zlib.h>
+#if defined(USE_LIBDEFLATE)
+#include <libdeflate.h>
+#endif
+
+#if defined(USE_LIBDEFLATE)
+static std::atomic<Inflater::Backend> selectedBackend{Inflater::Libdeflate};
+#else
+static std::atomic<Inflater::Backend> selectedBackend{Inflater::Zlib};
+#endif
+
+Inflater::Inflater()
+{
+    backend = selectedBackend;
+#if defined(USE_LIBDEFLATE)
+    if (backend == Libdeflate)
+    {
+        decompressor = libdeflate_alloc_decompressor();
+        if (decompressor == nullptr)
+        {
+            backend = Zlib;
+        }
+    }
+#endif
+}
+
+Inflater::~Inflater()
+{
+#if defined(USE_LIBDEFLATE)
+    if (decompressor != nullptr)
+    {
+        libdeflate_free_decompressor(decompressor);
+    }
+#endif
+}
+
+bool Inflater::inflate(const uchar *in, qint64 inSize, uchar *out, qint64 outSize)
+{
+#if defined(USE_LIBDEFLATE)
+    if (backend == Libdeflate)
+    {
+        size_t produced = 0;
+        libdeflate_result result = libdeflate_deflate_decompress(decompressor, in, static_cast<size_t>(inSize), out,
+                                                                 static_cast<size_t>(outSize), &produced);
+        return result == LIBDEFLATE_SUCCESS && produced == static_cast<size_t>(outSize);
+    }
+#endif
+    return inflateZlib(in, inSize, out, outSize);
+}
+
+bool Inflater::inflateZlib(const uchar *in, qint64 inSize, uchar *out, qint64 outSize)
+{
+    z_stream inflater;
+    memset(&inflater, 0, sizeof(inflater));
+    if (inflateInit2(&inflater, -MAX_WBITS) != Z_OK)
+    {
+        return false;
+    }
+    qint64 remainingIn = inSize;
+    qint64 remainingOut = outSize;
+    inflater.next_in = const_cast<Bytef *>(in);
+    inflater.next_out = out;
+    int ret = Z_OK;
+    // avail_in/avail_out are 32 bit, so feed entries over 4 GB in slices
+    while (ret == Z_OK)
+    {
+        uInt inSlice = static_cast<uInt>(qMin<qint64>(remainingIn, UINT_MAX));
+        uInt room = static_cast<uInt>(qMin<qint64>(remainingOut, UINT_MAX));
+        inflater.avail_in = inSlice;
+        inflater.avail_out = room;
+        ret = ::inflate(&inflater, Z_FINISH);
+        remainingIn -= inSlice - inflater.avail_in;
+        remainingOut -= room - inflater.avail_out;
+        if (ret == Z_BUF_ERROR && remainingIn > 0 && remainingOut > 0)
+        {
+            ret = Z_OK;
+        }
+    }
+    inflateEnd(&inflater);
+    return ret == Z_STREAM_END && remainingOut == 0;
+}
+
+quint32 Inflater::crc32(const uchar *data, qint64 size, quint32 crc)
+{
+#if defined(USE_LIBDEFLATE)
+    if (selectedBackend == Libdeflate)
+    {
+        return libdeflate_crc32(crc, data, static_cast<size_t>(size));
+    }
+#endif
+    uLong value = crc;
+    while (size > 0)
+    {
+        uInt length = static_cast<uInt>(qMin<qint64>(size, UINT_MAX));
+        value = ::crc32(value, data, length);
+        data += length;
+        size -= length;
+    }
+    return static_cast<quint32>(value);
+}
+
+bool Inflater::isAvailable(Backend backend)
+{
+#if defined(USE_LIBDEFLATE)
+    Q_UNUSED(backend);
+    return true;
+#else
+    return backend == Zlib;
+#endif
+}
+
+void Inflater::setDefaultBackend(Backend backend)
+{
+    if (isAvailable(backend))
+    {
+        selectedBackend = backend;
+    }
+}
+
+Inflater::Backend Inflater::defaultBackend()
+{
+    return selectedBackend;
+}
+
+QString Inflater::backendName(Backend backend)
+{
+    return backend == Libdeflate ? "libdeflate" : "zlib";
+}
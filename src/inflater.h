@@ -0,0 +1,51 @@
+#ifndef INFLATER_H
+#define INFLATER_H
+
+#include <QString>
+#include <QtGlobal>
+
+#if defined(USE_LIBDEFLATE)
+struct libdeflate_decompressor;
+#endif
+
+// One-shot decoder for raw deflate data whose uncompressed size is known
+// up front, which is every entry read through a zip central directory.
+// libdeflate (built with CONFIG+=libdeflate) decodes a whole entry in one
+// call with SIMD-optimised routines and is used when available; zlib (or
+// zlib-ng in compatibility mode) is the fallback. crc32() uses the same
+// backend, so the checksum gets libdeflate's PCLMUL/ARMv8 CRC paths too.
+//
+// An Inflater holds decoder state and must only be used by one thread at
+// a time; give each worker its own.
+class Inflater
+{
+public:
+    enum Backend
+    {
+        Zlib,
+        Libdeflate
+    };
+
+    Inflater();
+    ~Inflater();
+    // Decodes exactly outSize bytes; false on corrupt or short data
+    bool inflate(const uchar *in, qint64 inSize, uchar *out, qint64 outSize);
+
+    // Continues crc over data; start with 0
+    static quint32 crc32(const uchar *data, qint64 size, quint32 crc = 0);
+    static bool isAvailable(Backend backend);
+    // Backend for Inflaters created from now on, e.g. to compare them
+    static void setDefaultBackend(Backend backend);
+    static Backend defaultBackend();
+    static QString backendName(Backend backend);
+
+private:
+    Backend backend;
+#if defined(USE_LIBDEFLATE)
+    libdeflate_decompressor *decompressor = nullptr;
+#endif
+
+    static bool inflateZlib(const uchar *in, qint64 inSize, uchar *out, qint64 outSize);
+};
+
+#endif // INFLATER_H
@@ -0,0 +1,147 @@
+#include "installfilter.h"
+#include <QDir>
+
+InstallFilter::InstallFilter(Profile profile, const QStringList &includes, const QStringList &excludes)
+{
+    this->profile = profile;
+    this->includes = includes;
+    this->excludes = excludes;
+    includePatterns = compile(includes);
+    excludePatterns = compile(excludes);
+}
+
+QList<InstallFilter::Pattern> InstallFilter::compile(const QStringList &globs)
+{
+    QList<Pattern> patterns;
+    for (const QString &glob : globs)
+    {
+        QString pattern = QDir::cleanPath(glob.trimmed());
+        bool anchored = pattern.contains('/');
+        while (pattern.startsWith('/'))
+        {
+            pattern.remove(0, 1);
+        }
+        if (pattern.isEmpty() || pattern == ".")
+        {
+            continue;
+        }
+        patterns.append(Pattern{QRegularExpression(QRegularExpression::wildcardToRegularExpression(pattern)),
+                                anchored});
+    }
+    return patterns;
+}
+
+bool InstallFilter::matches(const QList<Pattern> &patterns, const QString &path)
+{
+    if (patterns.isEmpty())
+    {
+        return false;
+    }
+    // Every leading directory is tried too, so a pattern naming a directory
+    // covers the files below it
+    const QStringList components = path.split('/', Qt::SkipEmptyParts);
+    QString prefix;
+    for (const QString &component : components)
+    {
+        prefix = prefix.isEmpty() ? component : prefix + '/' + component;
+        for (const Pattern &pattern : patterns)
+        {
+            if (pattern.expression.match(pattern.anchored ? prefix : component).hasMatch())
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool InstallFilter::isEmpty() const
+{
+    return profile == Both && includePatterns.isEmpty() && excludePatterns.isEmpty();
+}
+
+bool InstallFilter::accepts(const QString &path) const
+{
+    if (isEmpty())
+    {
+        return true;
+    }
+    if (excludesTree(path))
+    {
+        return false;
+    }
+    return includePatterns.isEmpty() || matches(includePatterns, path);
+}
+
+bool InstallFilter::excludesTree(const QString &path) const
+{
+    QString top = path.section('/', 0, 0);
+    if ((profile == Client && top == "mage-server") || (profile == Server && top == "mage-client"))
+    {
+        return true;
+    }
+    return matches(excludePatterns, path);
+}
+
+QStringList InstallFilter::keptDirs(const QStringList &dirs) const
+{
+    QStringList kept;
+    for (const QString &dir : dirs)
+    {
+        if (!excludesTree(dir))
+        {
+            kept.append(dir);
+        }
+    }
+    return kept;
+}
+
+QString InstallFilter::key() const
+{
+    QString key = profileName(profile);
+    for (const QString &include : includes)
+    {
+        key += " +" + include;
+    }
+    for (const QString &exclude : excludes)
+    {
+        key += " -" + exclude;
+    }
+    return key;
+}
+
+bool InstallFilter::includesClient() const
+{
+    return profile != Server;
+}
+
+bool InstallFilter::includesServer() const
+{
+    return profile != Client;
+}
+
+QString InstallFilter::profileName(Profile profile)
+{
+    switch (profile)
+    {
+    case Client:
+        return "client";
+    case Server:
+        return "server";
+    default:
+        return "both";
+    }
+}
+
+InstallFilter::Profile InstallFilter::profileFromName(const QString &name)
+{
+    if (name == "client")
+    {
+        return Client;
+    }
+    if (name == "server")
+    {
+        return Server;
+    }
+    return Both;
+}
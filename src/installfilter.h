@@ -0,0 +1,63 @@
+#ifndef INSTALLFILTER_H
+#define INSTALLFILTER_H
+
+#include <QList>
+#include <QRegularExpression>
+#include <QString>
+#include <QStringList>
+
+// Which part of an XMage build gets installed: a component profile (client,
+// server or both) plus include and exclude globs. Paths are relative to the
+// build directory, '/'-separated. A glob without a '/' matches any single
+// path component ("*.bat"); one with a '/' matches from the build root
+// ("mage-client/plugins"). Either way a matching directory selects
+// everything under it. With includes, a file must match one of them; an
+// exclude or the profile always wins.
+//
+// Files left out are neither written nor removed. Owned directories only
+// hold what is selected, except those left out whole, which are not touched.
+class InstallFilter
+{
+public:
+    enum Profile
+    {
+        Both,
+        Client,
+        Server
+    };
+
+    InstallFilter(Profile profile = Both, const QStringList &includes = QStringList(),
+                  const QStringList &excludes = QStringList());
+    // True when everything is installed
+    bool isEmpty() const;
+    bool accepts(const QString &path) const;
+    // Whether path and everything under it is left out
+    bool excludesTree(const QString &path) const;
+    // dirs without the ones left out whole
+    QStringList keptDirs(const QStringList &dirs) const;
+    // Identifies the selection, to notice when it changed since an install
+    QString key() const;
+    bool includesClient() const;
+    bool includesServer() const;
+
+    static QString profileName(Profile profile);
+    static Profile profileFromName(const QString &name);
+
+private:
+    struct Pattern
+    {
+        QRegularExpression expression;
+        bool anchored; // Contains a '/', matched from the build root
+    };
+
+    Profile profile;
+    QStringList includes;
+    QStringList excludes;
+    QList<Pattern> includePatterns;
+    QList<Pattern> excludePatterns;
+
+    static QList<Pattern> compile(const QStringList &globs);
+    static bool matches(const QList<Pattern> &patterns, const QString &path);
+};
+
+#endif // INSTALLFILTER_H
@@ -0,0 +1,97 @@
+#include "installindex.h"
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+
+InstallIndex::InstallIndex(const QString &installPath)
+{
+    this->installPath = installPath;
+}
+
+bool InstallIndex::load()
+{
+    records.clear();
+    QFile file(installPath + "/" INSTALL_INDEX_FILE);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+    QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+    const QJsonArray files = root.value("files").toArray();
+    for (const QJsonValue &value : files)
+    {
+        // [path, size, crc, mtime]
+        QJsonArray record = value.toArray();
+        if (record.size() != 4)
+        {
+            continue;
+        }
+        records.insert(record[0].toString(), Record{record[1].toInteger(), static_cast<quint32>(record[2].toInteger()),
+                                                   record[3].toInteger()});
+    }
+    return !records.isEmpty();
+}
+
+bool InstallIndex::save() const
+{
+    QJsonArray files;
+    for (auto it = records.constBegin(); it != records.constEnd(); ++it)
+    {
+        files.append(QJsonArray{it.key(), it->size, static_cast<qint64>(it->crc), it->mtime});
+    }
+    QJsonObject root;
+    root.insert("files", files);
+
+    QSaveFile file(installPath + "/" INSTALL_INDEX_FILE);
+    return file.open(QIODevice::WriteOnly) && file.write(QJsonDocument(root).toJson(QJsonDocument::Compact)) >= 0 &&
+           file.commit();
+}
+
+void InstallIndex::clear()
+{
+    records.clear();
+}
+
+bool InstallIndex::matches(const QString &path, qint64 size, quint32 crc) const
+{
+    auto it = records.constFind(path);
+    if (it == records.constEnd() || it->size != size || it->crc != crc)
+    {
+        return false;
+    }
+    qint64 installedSize = -1;
+    qint64 mtime = modificationTime(installPath + '/' + path, &installedSize);
+    return installedSize == size && mtime == it->mtime;
+}
+
+void InstallIndex::insert(const QString &path, qint64 size, quint32 crc)
+{
+    qint64 installedSize = -1;
+    qint64 mtime = modificationTime(installPath + '/' + path, &installedSize);
+    if (installedSize != size)
+    {
+        records.remove(path);
+        return;
+    }
+    records.insert(path, Record{size, crc, mtime});
+}
+
+QStringList InstallIndex::paths() const
+{
+    return records.keys();
+}
+
+qint64 InstallIndex::modificationTime(const QString &path, qint64 *size)
+{
+    QFileInfo info(path);
+    if (!info.isFile())
+    {
+        return -1;
+    }
+    *size = info.size();
+    return info.lastModified().toMSecsSinceEpoch();
+}
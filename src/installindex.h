@@ -0,0 +1,43 @@
+#ifndef INSTALLINDEX_H
+#define INSTALLINDEX_H
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+#define INSTALL_INDEX_FILE ".install-index.json"
+
+// Record of the files an archive installed into a directory: relative
+// path, size, CRC-32 and modification time. A file still matches its
+// record while its size and mtime on disk are unchanged, so re-extracting
+// the same (or a mostly unchanged) archive can skip every entry with the
+// same size and CRC without reading the installed copy.
+class InstallIndex
+{
+public:
+    InstallIndex(const QString &installPath);
+    bool load();
+    bool save() const;
+    void clear();
+    // Whether path is installed with this size and CRC and was not touched
+    // since it was recorded
+    bool matches(const QString &path, qint64 size, quint32 crc) const;
+    // Records path as installed now, taking the mtime from disk
+    void insert(const QString &path, qint64 size, quint32 crc);
+    QStringList paths() const;
+
+private:
+    struct Record
+    {
+        qint64 size;
+        quint32 crc;
+        qint64 mtime;
+    };
+
+    QString installPath;
+    QHash<QString, Record> records;
+
+    static qint64 modificationTime(const QString &path, qint64 *size);
+};
+
+#endif // INSTALLINDEX_H
@@ -0,0 +1,132 @@
+#include "installswap.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QUuid>
+
+InstallSwap::InstallSwap(const QString &trash)
+{
+    this->trash = trash;
+}
+
+QString InstallSwap::errorMessage() const
+{
+    return error;
+}
+
+bool InstallSwap::move(const QString &from, const QString &to)
+{
+    // QDir::rename() renames files and directories alike
+    if (!QDir().rename(from, to))
+    {
+        error = "Error moving " + from + " to " + to;
+        return false;
+    }
+    steps.append(qMakePair(from, to));
+    return true;
+}
+
+bool InstallSwap::makeDirectory(const QString &path)
+{
+    QFileInfo info(path);
+    if (info.isDir() && !info.isSymLink())
+    {
+        return true;
+    }
+    if ((info.exists() || info.isSymLink()) && !discard(path))
+    {
+        return false;
+    }
+    if (!makeDirectory(info.path()))
+    {
+        return false;
+    }
+    if (!QDir().mkdir(path))
+    {
+        error = "Error creating directory " + path;
+        return false;
+    }
+    steps.append(qMakePair(QString(), path));
+    return true;
+}
+
+bool InstallSwap::discard(const QString &path)
+{
+    QFileInfo info(path);
+    if (!info.exists() && !info.isSymLink())
+    {
+        return true;
+    }
+    if (!makeDirectory(trash))
+    {
+        return false;
+    }
+    return move(path, trash + '/' + QUuid::createUuid().toString(QUuid::WithoutBraces));
+}
+
+bool InstallSwap::replaceDirectory(const QString &staged, const QString &installed)
+{
+    if (!discard(installed))
+    {
+        return false;
+    }
+    if (!QFileInfo::exists(staged))
+    {
+        // Not in the new build at all
+        return true;
+    }
+    return makeDirectory(QFileInfo(installed).path()) && move(staged, installed);
+}
+
+bool InstallSwap::moveTree(const QString &from, const QString &to)
+{
+    if (!makeDirectory(to))
+    {
+        return false;
+    }
+    const QFileInfoList entries = QDir(from).entryInfoList(QDir::AllEntries | QDir::Hidden | QDir::System |
+                                                           QDir::NoDotAndDotDot);
+    for (const QFileInfo &entry : entries)
+    {
+        QString target = to + '/' + entry.fileName();
+        QFileInfo targetInfo(target);
+        bool targetExists = targetInfo.exists() || targetInfo.isSymLink();
+        if (entry.isDir() && !entry.isSymLink())
+        {
+            // Whole directories move with a single rename when nothing is in the way
+            if (!targetExists)
+            {
+                if (!move(entry.absoluteFilePath(), target))
+                {
+                    return false;
+                }
+                continue;
+            }
+            if (!moveTree(entry.absoluteFilePath(), target))
+            {
+                return false;
+            }
+        }
+        else if ((targetExists && !discard(target)) || !move(entry.absoluteFilePath(), target))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void InstallSwap::rollback()
+{
+    for (int i = steps.size() - 1; i >= 0; i--)
+    {
+        const QPair<QString, QString> &step = steps[i];
+        if (step.first.isEmpty())
+        {
+            QDir().rmdir(step.second);
+        }
+        else
+        {
+            QDir().rename(step.second, step.first);
+        }
+    }
+    steps.clear();
+}
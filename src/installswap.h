@@ -0,0 +1,38 @@
+#ifndef INSTALLSWAP_H
+#define INSTALLSWAP_H
+
+#include <QList>
+#include <QPair>
+#include <QString>
+
+// Moves a staged build into an install as a series of renames. Nothing in
+// the install is deleted: whatever a staged file or directory replaces,
+// and whatever discard() is given, is renamed into the trash directory
+// (which must be on the same volume). Every rename is recorded, so after a
+// failure rollback() undoes them newest first and leaves the install as it
+// was. Once the swap succeeded the trash can be emptied in the background.
+class InstallSwap
+{
+public:
+    InstallSwap(const QString &trash);
+    // Replaces the directory installed with staged as a whole. A missing
+    // staged directory just moves installed out of the way.
+    bool replaceDirectory(const QString &staged, const QString &installed);
+    // Moves the tree under from into to, replacing what already exists
+    bool moveTree(const QString &from, const QString &to);
+    // Moves a file or directory out of the install
+    bool discard(const QString &path);
+    void rollback();
+    QString errorMessage() const;
+
+private:
+    QString trash;
+    // Renames as (from, to), in order; an empty from is a directory created
+    QList<QPair<QString, QString>> steps;
+    QString error;
+
+    bool move(const QString &from, const QString &to);
+    bool makeDirectory(const QString &path);
+};
+
+#endif // INSTALLSWAP_H
@@ -0,0 +1,46 @@
+#include "linesplitter.h"
+
+QStringList LineSplitter::split(const QByteArray &data)
+{
+    QStringList lines;
+    // The decoder holds back a sequence cut at the end of data until the
+    // rest of it arrives
+    partial += decoder.decode(data);
+    qsizetype start = 0;
+    qsizetype newline;
+    while ((newline = partial.indexOf('\n', start)) >= 0)
+    {
+        qsizetype end = newline;
+        if (end > start && partial.at(end - 1) == '\r')
+        {
+            end--;
+        }
+        for (qsizetype pos = start; pos < end || pos == start; pos += LINE_SPLITTER_MAX_LENGTH)
+        {
+            lines.append(partial.mid(pos, qMin<qsizetype>(end - pos, LINE_SPLITTER_MAX_LENGTH)));
+        }
+        start = newline + 1;
+    }
+    while (partial.size() - start > LINE_SPLITTER_MAX_LENGTH)
+    {
+        lines.append(partial.mid(start, LINE_SPLITTER_MAX_LENGTH));
+        start += LINE_SPLITTER_MAX_LENGTH;
+    }
+    partial.remove(0, start);
+    return lines;
+}
+
+QStringList LineSplitter::flush()
+{
+    QStringList lines;
+    if (partial.endsWith('\r'))
+    {
+        partial.chop(1);
+    }
+    if (!partial.isEmpty())
+    {
+        lines.append(partial);
+        partial.clear();
+    }
+    return lines;
+}
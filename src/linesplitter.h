@@ -0,0 +1,29 @@
+#ifndef LINESPLITTER_H
+#define LINESPLITTER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringDecoder>
+#include <QStringList>
+
+// Longer lines are cut into pieces of this many characters, so a child that
+// never prints a newline cannot grow one line without bound
+#define LINE_SPLITTER_MAX_LENGTH 2000
+
+// Turns a byte stream of UTF-8 text into lines. Chunks may end anywhere,
+// including inside a multi-byte sequence or a "\r\n"; the unfinished part
+// is kept for the next chunk. Invalid bytes become U+FFFD.
+class LineSplitter
+{
+public:
+    // The lines data completed, without their line endings
+    QStringList split(const QByteArray &data);
+    // The unterminated last line, if any
+    QStringList flush();
+
+private:
+    QStringDecoder decoder{QStringDecoder::Utf8};
+    QString partial;
+};
+
+#endif // LINESPLITTER_H
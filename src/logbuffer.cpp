@@ -0,0 +1,76 @@
+#include "logbuffer.h"
+
+LogBuffer::LogBuffer(int capacity, QObject *parent)
+    : QObject(parent)
+{
+    this->capacity = qMax(1, capacity);
+    ring.resize(this->capacity);
+}
+
+void LogBuffer::append(const QString &line)
+{
+    {
+        QMutexLocker locker(&mutex);
+        ring[total % capacity] = line;
+        total++;
+    }
+    notify();
+}
+
+void LogBuffer::append(const QStringList &lines)
+{
+    if (lines.isEmpty())
+    {
+        return;
+    }
+    {
+        QMutexLocker locker(&mutex);
+        // Of a batch larger than the ring only the tail survives anyway
+        qsizetype skip = qMax<qsizetype>(0, lines.size() - capacity);
+        total += skip;
+        for (qsizetype i = skip; i < lines.size(); i++)
+        {
+            ring[total % capacity] = lines[i];
+            total++;
+        }
+    }
+    notify();
+}
+
+void LogBuffer::notify()
+{
+    if (!notified.exchange(true))
+    {
+        emit lines_added();
+    }
+}
+
+void LogBuffer::acknowledge()
+{
+    notified = false;
+}
+
+qint64 LogBuffer::first() const
+{
+    QMutexLocker locker(&mutex);
+    return qMax<qint64>(0, total - capacity);
+}
+
+qint64 LogBuffer::end() const
+{
+    QMutexLocker locker(&mutex);
+    return total;
+}
+
+QStringList LogBuffer::lines(qint64 from, qint64 to) const
+{
+    QMutexLocker locker(&mutex);
+    QStringList result;
+    from = qMax(from, qMax<qint64>(0, total - capacity));
+    to = qMin(to, total);
+    for (qint64 i = from; i < to; i++)
+    {
+        result.append(ring[i % capacity]);
+    }
+    return result;
+}
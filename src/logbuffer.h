@@ -0,0 +1,46 @@
+#ifndef LOGBUFFER_H
+#define LOGBUFFER_H
+
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <atomic>
+
+#define LOG_BUFFER_CAPACITY 20000
+
+// The launcher log: a fixed number of lines in a ring, the oldest dropped
+// as new ones arrive, so a server left running for days keeps its memory
+// flat. Lines are numbered from the first one ever appended; lines before
+// first() were dropped. append() and the readers may be called from any
+// thread.
+class LogBuffer : public QObject
+{
+    Q_OBJECT
+public:
+    LogBuffer(int capacity = LOG_BUFFER_CAPACITY, QObject *parent = nullptr);
+    void append(const QString &line);
+    void append(const QStringList &lines);
+    qint64 first() const;
+    qint64 end() const;
+    // Lines [from, to) that are still held
+    QStringList lines(qint64 from, qint64 to) const;
+    // Re-arms lines_added(); call before reading what it announced
+    void acknowledge();
+
+signals:
+    // Sent once per batch of appends until acknowledge(), not once per line
+    void lines_added();
+
+private:
+    mutable QMutex mutex;
+    QList<QString> ring;
+    int capacity;
+    qint64 total = 0;
+    std::atomic<bool> notified{false};
+
+    void notify();
+};
+
+#endif // LOGBUFFER_H
@@ -0,0 +1,155 @@
+#include "logview.h"
+#include <QClipboard>
+#include <QContextMenuEvent>
+#include <QFontDatabase>
+#include <QGuiApplication>
+#include <QKeyEvent>
+#include <QMenu>
+#include <QPainter>
+#include <QScrollBar>
+
+LogView::LogView(QWidget *parent)
+    : QAbstractScrollArea(parent)
+{
+    setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    frameTimer.setSingleShot(true);
+    frameTimer.setInterval(LOG_VIEW_FRAME_INTERVAL);
+    connect(&frameTimer, &QTimer::timeout, this, &LogView::refresh);
+    connect(verticalScrollBar(), &QScrollBar::valueChanged, this, [this](int value) {
+        if (!adjusting)
+        {
+            following = value == verticalScrollBar()->maximum();
+        }
+        viewport()->update();
+    });
+    connect(horizontalScrollBar(), &QScrollBar::valueChanged, viewport(), QOverload<>::of(&QWidget::update));
+}
+
+void LogView::setBuffer(LogBuffer *buffer)
+{
+    this->buffer = buffer;
+    connect(buffer, &LogBuffer::lines_added, this, &LogView::lines_added);
+    refresh();
+}
+
+qint64 LogView::paintCount() const
+{
+    return paints;
+}
+
+void LogView::lines_added()
+{
+    // Everything that arrives until the timer fires goes into one refresh
+    if (!frameTimer.isActive())
+    {
+        frameTimer.start();
+    }
+}
+
+void LogView::refresh()
+{
+    if (buffer == nullptr)
+    {
+        return;
+    }
+    buffer->acknowledge();
+    qint64 first = buffer->first();
+    qint64 end = buffer->end();
+
+    // Only lines not seen before are measured, for the horizontal range
+    const QStringList fresh = buffer->lines(qMax(scannedEnd, first), end);
+    for (const QString &line : fresh)
+    {
+        longestLine = qMax(longestLine, static_cast<int>(line.size()));
+    }
+    scannedEnd = end;
+
+    // When old lines drop off the top, the rows being read keep their place
+    adjusting = true;
+    int value = verticalScrollBar()->value() - static_cast<int>(first - shownFirst);
+    shownFirst = first;
+    shownEnd = end;
+    updateScrollBars();
+    verticalScrollBar()->setValue(following ? verticalScrollBar()->maximum() : qMax(0, value));
+    adjusting = false;
+    viewport()->update();
+}
+
+int LogView::lineHeight() const
+{
+    return fontMetrics().lineSpacing();
+}
+
+int LogView::visibleLines() const
+{
+    return qMax(1, viewport()->height() / lineHeight());
+}
+
+void LogView::updateScrollBars()
+{
+    int rows = visibleLines();
+    verticalScrollBar()->setRange(0, static_cast<int>(qMax<qint64>(0, shownEnd - shownFirst - rows)));
+    verticalScrollBar()->setPageStep(rows);
+    // The font is fixed-width, so the longest line gives the content width
+    int width = longestLine * fontMetrics().horizontalAdvance(QLatin1Char('M'));
+    horizontalScrollBar()->setRange(0, qMax(0, width - viewport()->width()));
+    horizontalScrollBar()->setPageStep(viewport()->width());
+}
+
+void LogView::paintEvent(QPaintEvent *)
+{
+    paints++;
+    if (buffer == nullptr)
+    {
+        return;
+    }
+    QPainter painter(viewport());
+    painter.setPen(palette().color(QPalette::Text));
+    int height = lineHeight();
+    int x = LOG_VIEW_MARGIN - horizontalScrollBar()->value();
+    int y = fontMetrics().ascent();
+    qint64 top = shownFirst + verticalScrollBar()->value();
+    const QStringList rows = buffer->lines(top, qMin(shownEnd, top + visibleLines() + 1));
+    for (const QString &row : rows)
+    {
+        painter.drawText(x, y, row);
+        y += height;
+    }
+}
+
+void LogView::resizeEvent(QResizeEvent *event)
+{
+    QAbstractScrollArea::resizeEvent(event);
+    adjusting = true;
+    updateScrollBars();
+    if (following)
+    {
+        verticalScrollBar()->setValue(verticalScrollBar()->maximum());
+    }
+    adjusting = false;
+}
+
+void LogView::keyPressEvent(QKeyEvent *event)
+{
+    if (event->matches(QKeySequence::Copy))
+    {
+        copyAll();
+        return;
+    }
+    QAbstractScrollArea::keyPressEvent(event);
+}
+
+void LogView::contextMenuEvent(QContextMenuEvent *event)
+{
+    QMenu menu(this);
+    menu.addAction("Copy log", this, &LogView::copyAll);
+    menu.exec(event->globalPos());
+}
+
+void LogView::copyAll()
+{
+    if (buffer != nullptr)
+    {
+        QGuiApplication::clipboard()->setText(buffer->lines(buffer->first(), buffer->end()).join('\n'));
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef LOGVIEW_H
+#define LOGVIEW_H
+
+#include <QAbstractScrollArea>
+#include <QTimer>
+#include "logbuffer.h"
+
+// About one frame at 60 Hz
+#define LOG_VIEW_FRAME_INTERVAL 16
+#define LOG_VIEW_MARGIN 4
+
+// Shows a LogBuffer without copying it into a text document: only the rows
+// in view are fetched and painted. However fast lines arrive, the view
+// refreshes at most once per frame. While scrolled to the bottom it
+// follows new lines; scrolled up, it stays on the lines being read.
+class LogView : public QAbstractScrollArea
+{
+    Q_OBJECT
+public:
+    LogView(QWidget *parent = nullptr);
+    void setBuffer(LogBuffer *buffer);
+    qint64 paintCount() const;
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void keyPressEvent(QKeyEvent *event) override;
+    void contextMenuEvent(QContextMenuEvent *event) override;
+
+private:
+    LogBuffer *buffer = nullptr;
+    QTimer frameTimer;
+    // Buffer range at the last refresh; later lines wait for the next one
+    qint64 shownFirst = 0;
+    qint64 shownEnd = 0;
+    qint64 scannedEnd = 0; // Lines up to here were measured for the width
+    int longestLine = 0;
+    bool following = true;
+    bool adjusting = false; // Scroll bar changes made by refresh(), not the user
+    qint64 paints = 0;
+
+    int lineHeight() const;
+    int visibleLines() const;
+    void updateScrollBars();
+    void copyAll();
+
+private slots:
+    void lines_added();
+    void refresh();
+};
+
+#endif // LOGVIEW_H
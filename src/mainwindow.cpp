@@ -1,8 +1,8 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 #include "downloadmanager.h"
+#include "tarstreamthread.h"
 #include "unzipthread.h"
-#include "zipextractthread.h"
 #include <QCoreApplication>
 #include <QDesktopServices>
 #include <QUrl>
@@ -12,8 +12,12 @@ MainWindow::MainWindow(QWidget *parent)
     , ui(new Ui::MainWindow)
     , background(new QLabel(this))
     , settings(new Settings)
+    , logBuffer(new LogBuffer(LOG_BUFFER_CAPACITY, this))
+    , network(new NetworkService(this))
 {
     ui->setupUi(this);
+    ui->log->setBuffer(logBuffer);
+    progressTracker = new ProgressTracker(ui->progressBar, this);
     ui->progressBar->hide();
     ui->progressBar->setAlignment(Qt::AlignCenter);
     this->setFixedSize(this->size());
@@ -34,29 +38,52 @@ MainWindow::MainWindow(QWidget *parent)
     }
     updateBuildInfo();
     updateLaunchReadiness();
+
+    network->scheduler()->setRateLimit(settings->downloadRateLimit * 1024);
+
+    // Most sessions start with a config fetch, get the handshake out of the way
+    network->preconnect(QUrl(settings->getCurrentBuildUrl()));
+
+    // Once the window has settled, look for a newer XMage to stage
+    QTimer::singleShot(BACKGROUND_UPDATE_DELAY, this, [this]() {
+        if (!preparing)
+        {
+            fetchConfig();
+        }
+    });
 }
 
 MainWindow::~MainWindow()
 {
-    if (javaSaveFile != nullptr)
+    // A process still running, such as a server left open on purpose,
+    // outlives logBuffer
+    if (clientProcess != nullptr)
+    {
+        clientProcess->detach();
+    }
+    if (serverProcess != nullptr)
     {
-        delete javaSaveFile;
+        serverProcess->detach();
     }
-    if (javaNetworkManager != nullptr)
+    // Downloads hold replies owned by the shared network service, so they
+    // must go before it does
+    qDeleteAll(findChildren<DownloadManager *>(QString(), Qt::FindDirectChildrenOnly));
+    if (updateStager != nullptr)
     {
-        delete javaNetworkManager;
+        delete updateStager;
     }
-    if (configNetworkManager != nullptr)
+    if (javaDownload != nullptr)
     {
-        delete configNetworkManager;
+        delete javaDownload;
     }
-    if (decksSaveFile != nullptr)
+    if (javaExtract != nullptr)
     {
-        delete decksSaveFile;
+        javaExtract->abort();
+        javaExtract->wait();
     }
-    if (decksNetworkManager != nullptr)
+    if (decksDownload != nullptr)
     {
-        delete decksNetworkManager;
+        delete decksDownload;
     }
     delete settings;
     delete background;
@@ -65,7 +92,7 @@ MainWindow::~MainWindow()
 
 void MainWindow::log(QString message)
 {
-    ui->log->appendPlainText(message);
+    logBuffer->append(message.split('\n'));
 }
 
 void MainWindow::setButtonsEnabled(bool enabled)
@@ -76,7 +103,7 @@ void MainWindow::setButtonsEnabled(bool enabled)
 }
 
 // =============================================================================
-// Launch preparation chain: config → java → xmage → decks → launch
+// Launch preparation graph: config → (java, xmage) → launch, decks alongside
 // =============================================================================
 
 void MainWindow::prepareLaunch(std::function<void()> onReady)
@@ -90,11 +117,76 @@ void MainWindow::prepareLaunch(std::function<void()> onReady)
     preparing = true;
     pendingLaunch = onReady;
     setButtonsEnabled(false);
+    progressTracker->reset();
     ui->progressBar->show();
-    ui->progressBar->setValue(0);
 
-    // Step 1: Fetch config
-    prepareStepConfig();
+    // A previous graph may still be finishing optional downloads; those
+    // carry on and report to whichever graph is current
+    if (prepareGraph != nullptr)
+    {
+        prepareGraph->deleteLater();
+    }
+
+    // Java and XMage only need the config, so they download side by side.
+    // Decks are optional and may still be downloading when the game starts.
+    prepareGraph = new TaskGraph(this);
+    prepareGraph->addTask("config", QStringList(), [this]() { prepareStepConfig(); });
+    prepareGraph->addTask("java", QStringList() << "config", [this]() { prepareStepJava(); });
+    prepareGraph->addTask("xmage", QStringList() << "config", [this]() { prepareStepXmage(); });
+    prepareGraph->addTask("decks", QStringList(), [this]() { prepareStepDecks(); }, false);
+    connect(prepareGraph, &TaskGraph::ready, this, &MainWindow::prepareReady);
+    connect(prepareGraph, &TaskGraph::failed, this, [this](QString, QString error) { prepareFailed(error); });
+    connect(prepareGraph, &TaskGraph::finished, this, [this]() {
+        if (!preparing)
+        {
+            ui->progressBar->hide();
+            progressTracker->reset();
+        }
+    });
+    prepareGraph->start();
+}
+
+void MainWindow::prepareTaskDone(const QString &task)
+{
+    if (prepareGraph != nullptr)
+    {
+        prepareGraph->complete(task);
+    }
+}
+
+void MainWindow::prepareTaskFailed(const QString &task, const QString &error)
+{
+    if (prepareGraph != nullptr)
+    {
+        prepareGraph->fail(task, error);
+    }
+}
+
+void MainWindow::prepareReady()
+{
+    preparing = false;
+    if (!prepareGraph->isRunning("decks"))
+    {
+        ui->progressBar->hide();
+        progressTracker->reset();
+    }
+    setButtonsEnabled(true);
+
+    if (pendingLaunch)
+    {
+        auto launch = pendingLaunch;
+        pendingLaunch = nullptr;
+        launch();
+    }
+
+    // A newer version or a changed profile is staged while the game runs,
+    // for the next launch to switch to
+    startBackgroundUpdate();
+
+    // Files replaced by an install or update; nothing waits on them any more
+    UnzipThread::deleteInBackground(UnzipThread::trashPath(settings->getCurrentBuildInstallPath()));
+    UnzipThread::deleteInBackground(UnzipThread::trashPath(settings->basePath + "/java"));
+    UnzipThread::deleteInBackground(UnzipThread::trashPath(settings->basePath));
 }
 
 void MainWindow::prepareFailed(const QString &error)
@@ -103,78 +195,97 @@ void MainWindow::prepareFailed(const QString &error)
     preparing = false;
     pendingLaunch = nullptr;
     ui->progressBar->hide();
-    ui->progressBar->setValue(0);
-    ui->progressBar->setFormat("%p%");
-    setButtonsEnabled(true);
+    progressTracker->reset();
+    // A download still running in parallel re-enables the buttons when it
+    // ends, so a retry cannot start a second copy of it
+    if (!prepareGraph->isRunning("java") && !prepareGraph->isRunning("xmage"))
+    {
+        setButtonsEnabled(true);
+    }
 }
 
 void MainWindow::prepareStepConfig()
 {
-    log("Checking for updates...");
-
-    if (configNetworkManager == nullptr)
+    // With a cached config the launch goes ahead right away and the server
+    // copy is revalidated in the background for the next launch
+    QJsonObject config;
+    if (loadCachedConfig(&config))
     {
-        configNetworkManager = new QNetworkAccessManager(this);
+        log("Checking for updates in the background...");
+        prepareTaskDone("config");
     }
     else
     {
-        configNetworkManager->disconnect();
+        log("Checking for updates...");
     }
-
-    connect(configNetworkManager, &QNetworkAccessManager::finished, this, &MainWindow::onConfigFetched);
-    QNetworkRequest request(QUrl(settings->getCurrentBuildUrl()));
-    request.setAttribute(QNetworkRequest::RedirectPolicyAttribute,
-                         QNetworkRequest::NoLessSafeRedirectPolicy);
-    configNetworkManager->get(request);
+    fetchConfig();
 }
 
 void MainWindow::onConfigFetched(QNetworkReply *reply)
 {
-    configNetworkManager->disconnect();
+    configReply = nullptr;
+    reply->deleteLater();
+    bool waiting = prepareGraph != nullptr && prepareGraph->isRunning("config");
 
     if (reply->error() != QNetworkReply::NoError)
     {
         log("Failed to fetch config: " + reply->errorString());
-        reply->deleteLater();
 
         // If we have a cached config, continue with it
         QJsonObject config;
-        if (preparing && loadCachedConfig(&config))
+        if (waiting && loadCachedConfig(&config))
         {
             log("Using cached config instead");
-            prepareStepJava();
+            prepareTaskDone("config");
         }
-        else if (preparing)
+        else if (waiting)
         {
-            prepareFailed("No config available");
+            prepareTaskFailed("config", "No config available");
         }
         return;
     }
 
+    if (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 304)
+    {
+        log("Config is up to date");
+        prepareTaskDone("config");
+        startBackgroundUpdate();
+        return;
+    }
+
     QByteArray data = reply->readAll();
-    reply->deleteLater();
 
     QJsonDocument doc = QJsonDocument::fromJson(data);
     if (doc.isNull() || !doc.isObject())
     {
         log("Error: Invalid JSON in config response");
-        if (preparing)
+        if (waiting)
         {
-            prepareFailed("Invalid config from server");
+            prepareTaskFailed("config", "Invalid config from server");
         }
         return;
     }
 
-    // Save to build folder
+    // Save to build folder, with the validators for the next revalidation
     QString buildPath = settings->getCurrentBuildInstallPath();
     QDir().mkpath(buildPath);
-    QString configPath = buildPath + "/config.json";
 
-    QFile file(configPath);
+    QSaveFile file(buildPath + "/config.json");
     if (file.open(QIODevice::WriteOnly))
     {
         file.write(data);
-        file.close();
+        file.commit();
+    }
+
+    QJsonObject validators;
+    validators.insert("url", settings->getCurrentBuildUrl());
+    validators.insert("etag", QString::fromLatin1(reply->rawHeader("ETag")));
+    validators.insert("lastModified", QString::fromLatin1(reply->rawHeader("Last-Modified")));
+    QSaveFile validatorsFile(buildPath + "/config.meta.json");
+    if (validatorsFile.open(QIODevice::WriteOnly))
+    {
+        validatorsFile.write(QJsonDocument(validators).toJson());
+        validatorsFile.commit();
     }
 
     QJsonObject root = doc.object();
@@ -184,11 +295,11 @@ void MainWindow::onConfigFetched(QNetworkReply *reply)
         log("Latest version: " + version);
     }
 
-    // Continue preparation chain
-    if (preparing)
+    if (waiting)
     {
-        prepareStepJava();
+        prepareTaskDone("config");
     }
+    startBackgroundUpdate();
 }
 
 void MainWindow::prepareStepJava()
@@ -196,25 +307,29 @@ void MainWindow::prepareStepJava()
     QFileInfo javaInfo(settings->javaInstallLocation);
     if (javaInfo.isExecutable())
     {
-        // Java already installed, skip to next step
-        prepareStepXmage();
+        prepareTaskDone("java");
         return;
     }
 
     QJsonObject config;
     if (!loadCachedConfig(&config))
     {
-        prepareFailed("No config available for Java download");
+        prepareTaskFailed("java", "No config available for Java download");
         return;
     }
 
     QJsonObject javaObj = config.value("java").toObject();
     javaVersion = javaObj.value("version").toString();
     javaBaseUrl = javaObj.value("location").toString();
+    javaMirrors = javaObj.value("mirrors");
+    javaSuffix = getJavaPlatformSuffix(javaObj);
+    // Either one digest or one per platform archive, keyed like the suffix
+    QJsonValue sha256 = javaObj.value("sha256");
+    javaSha256 = sha256.isObject() ? sha256.toObject().value(javaSuffix).toString() : sha256.toString();
 
     if (javaBaseUrl.isEmpty())
     {
-        prepareFailed("No Java download URL in config");
+        prepareTaskFailed("java", "No Java download URL in config");
         return;
     }
 
@@ -227,20 +342,49 @@ void MainWindow::prepareStepXmage()
 {
     // Check if XMage is already installed
     QString buildPath = settings->getCurrentBuildInstallPath();
-    bool hasXmage = QDir(buildPath + "/mage-client/lib").exists() ||
-                    QDir(buildPath + "/xmage/mage-client/lib").exists();
+    bool hasXmage = isXmageInstalled();
+
+    QJsonObject config;
+    bool hasConfig = loadCachedConfig(&config);
 
     if (hasXmage)
     {
-        // TODO: check for version updates
-        prepareStepDecks();
+        // An installed build never waits on the network: newer versions and
+        // profile changes are staged in the background and switched to here
+        QString latest = config.value("XMage").toObject().value("version").toString();
+        QString installed = installedXmageVersion();
+        QString profile = settings->installFilter().key();
+        bool outdated = !latest.isEmpty() && (latest != installed || installedXmageProfile() != profile);
+        bool staged = UpdateStager::stagedVersion(buildPath) == latest && UpdateStager::stagedProfile(buildPath) == profile;
+        if (outdated && staged && (clientProcess != nullptr || serverProcess != nullptr))
+        {
+            // Never swap files under a running game
+            log("XMage is running, keeping version " + installed + " for now");
+        }
+        else if (outdated && staged)
+        {
+            QString error;
+            if (UpdateStager::applyStaged(buildPath, DownloadManager::managedDirs(), &error))
+            {
+                log("Switched to XMage " + latest + " downloaded in the background");
+                setInstalledXmageVersion(latest);
+            }
+            else
+            {
+                log("Could not switch to the staged update, keeping the installed version: " + error);
+            }
+        }
+        else if (outdated)
+        {
+            log("XMage " + latest + " is not downloaded yet, launching the installed version");
+        }
+        prepareTaskDone("xmage");
         return;
     }
 
-    QJsonObject config;
-    if (!loadCachedConfig(&config))
+    if (!hasConfig)
     {
-        prepareFailed("No config available for XMage download");
+        prepareTaskFailed("xmage", "No config available for XMage download");
         return;
     }
 
@@ -250,22 +394,10 @@ void MainWindow::prepareStepXmage()
 
 void MainWindow::prepareStepDecks()
 {
-    // Check if decks already exist
-    if (QDir(settings->basePath + "/decks").exists())
+    // Already installed, or still downloading from an earlier launch
+    if (QDir(settings->basePath + "/decks").exists() || decksDownloading)
     {
-        // Decks already downloaded, ready to launch
-        preparing = false;
-        ui->progressBar->hide();
-        ui->progressBar->setValue(0);
-        ui->progressBar->setFormat("%p%");
-        setButtonsEnabled(true);
-
-        if (pendingLaunch)
-        {
-            auto launch = pendingLaunch;
-            pendingLaunch = nullptr;
-            launch();
-        }
+        prepareTaskDone("decks");
         return;
     }
 
@@ -275,35 +407,16 @@ void MainWindow::prepareStepDecks()
     QString url = "https://github.com/t-my/metagame-decks/releases/latest/download/metagame-decks.zip";
     QString fileName = settings->basePath + "/metagame-decks.zip";
 
-    if (decksNetworkManager == nullptr)
-    {
-        decksNetworkManager = new QNetworkAccessManager(this);
-    }
-    else
-    {
-        decksNetworkManager->disconnect();
-    }
-
-    decksSaveFile = new QSaveFile(fileName);
-    if (!decksSaveFile->open(QIODevice::WriteOnly))
-    {
-        log("Failed to create file: " + fileName);
-        delete decksSaveFile;
-        decksSaveFile = nullptr;
-        decksDownloading = false;
-        prepareFailed("Could not create decks download file");
-        return;
-    }
-
-    QUrl downloadUrl(url);
-    QNetworkRequest request(downloadUrl);
-    request.setAttribute(QNetworkRequest::RedirectPolicyAttribute,
-                         QNetworkRequest::NoLessSafeRedirectPolicy);
-
-    connect(decksNetworkManager, &QNetworkAccessManager::finished, this, &MainWindow::onDecksDownloadFinished);
-    decksDownloadReply = decksNetworkManager->get(request);
-    connect(decksDownloadReply, &QNetworkReply::downloadProgress, this, &MainWindow::onDecksDownloadProgress);
-    connect(decksDownloadReply, &QNetworkReply::readyRead, this, &MainWindow::onDecksDownloadReadyRead);
+    decksDownload = new FileDownload(network, QUrl(url), fileName, this);
+    // Optional, so it should not compete with the Java and XMage downloads
+    decksDownload->setPriority(TransferScheduler::Background);
+    decksDownload->setChecksumUrl(QUrl(url + ".sha256"));
+    connect(decksDownload, &FileDownload::log, this, &MainWindow::log);
+    progressTracker->addStage(decksDownload, "Downloading decks");
+    connect(decksDownload, &FileDownload::progress, progressTracker, &ProgressTracker::update);
+    connect(decksDownload, &FileDownload::download_complete, this, &MainWindow::onDecksDownloadFinished);
+    connect(decksDownload, &FileDownload::download_fail, this, &MainWindow::onDecksDownloadFailed);
+    decksDownload->start();
 }
 
 // =============================================================================
@@ -344,8 +457,11 @@ void MainWindow::on_actionSettings_triggered()
     SettingsDialog *settingsDialog = new SettingsDialog(settings, this);
     connect(settingsDialog, &QDialog::accepted, this, [this]() {
         log("Build changed to: " + settings->currentBuildName);
+        network->preconnect(QUrl(settings->getCurrentBuildUrl()));
+        network->scheduler()->setRateLimit(settings->downloadRateLimit * 1024);
         updateBuildInfo();
         updateLaunchReadiness();
+        startBackgroundUpdate();
     });
     settingsDialog->open();
 }
@@ -370,10 +486,12 @@ void MainWindow::doLaunchClient()
     log("  Java: " + settings->javaInstallLocation);
     log("  Build: " + settings->currentBuildName);
     log("  Client dir: " + clientDir);
+    log("  Session log: " + settings->basePath + "/logs");
     ui->clientButton->setText("Stop Client");
-    clientProcess = new XMageProcess(ui->log);
-    connect(clientProcess, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this, &MainWindow::client_finished);
+    clientProcess = new XMageProcess(logBuffer);
+    connect(clientProcess, &XMageProcess::finished, this, &MainWindow::client_finished);
     clientProcess->setWorkingDirectory(clientDir);
+    clientProcess->setSessionLog(settings->basePath + "/logs", "client");
     QStringList arguments = settings->currentClientOptions;
     arguments << "-jar" << clientJar;
     clientProcess->start(settings->javaInstallLocation, arguments);
@@ -400,10 +518,12 @@ void MainWindow::doLaunchServer()
     log("  Java: " + settings->javaInstallLocation);
     log("  Build: " + settings->currentBuildName);
     log("  Server dir: " + serverDir);
+    log("  Session log: " + settings->basePath + "/logs");
     ui->serverButton->setText("Stop Server");
-    serverProcess = new XMageProcess(ui->log);
-    connect(serverProcess, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this, &MainWindow::server_finished);
+    serverProcess = new XMageProcess(logBuffer);
+    connect(serverProcess, &XMageProcess::finished, this, &MainWindow::server_finished);
     serverProcess->setWorkingDirectory(serverDir);
+    serverProcess->setSessionLog(settings->basePath + "/logs", "server");
     QStringList arguments = settings->currentServerOptions;
     arguments << "-jar" << serverJar;
     serverProcess->start(settings->javaInstallLocation, arguments);
@@ -440,6 +560,16 @@ void MainWindow::closeEvent(QCloseEvent *event)
     event->accept();
 }
 
+void MainWindow::changeEvent(QEvent *event)
+{
+    if (event->type() == QEvent::WindowStateChange)
+    {
+        // Nobody sees the progress bar of a minimized window
+        progressTracker->setPaused(isMinimized());
+    }
+    QMainWindow::changeEvent(event);
+}
+
 void MainWindow::client_finished()
 {
     clientProcess = nullptr;
@@ -458,7 +588,7 @@ void MainWindow::server_finished()
 
 void MainWindow::startXmageDownload(const QJsonObject &config)
 {
-    QJsonObject xmageObj = config.value("XMage").toObject();
+    QJsonObject xmageObj = xmageBuildInfo(config);
     QString downloadUrl = xmageObj.value("full").toString();
     QString version = xmageObj.value("version").toString();
 
@@ -466,7 +596,7 @@ void MainWindow::startXmageDownload(const QJsonObject &config)
     {
         if (preparing)
         {
-            prepareFailed("No XMage download URL in config");
+            prepareTaskFailed("xmage", "No XMage download URL in config");
         }
         return;
     }
@@ -474,8 +604,12 @@ void MainWindow::startXmageDownload(const QJsonObject &config)
     QString downloadLocation = settings->getCurrentBuildInstallPath();
     QDir().mkpath(downloadLocation);
 
+    xmageDownloadVersion = version;
+    DownloadManager *downloadManager = new DownloadManager(downloadLocation, network, this);
+    downloadManager->setFilter(settings->installFilter());
+    downloadManager->setExpectedSha256(xmageObj.value("sha256").toString().toLatin1());
+    downloadManager->setMirrors(FileDownload::urlList(xmageObj.value("mirrors")));
     log("Downloading XMage " + version + " to: " + downloadLocation);
-    DownloadManager *downloadManager = new DownloadManager(downloadLocation, this);
     downloadManager->downloadXmageFromUrl(downloadUrl, version);
 }
 
@@ -483,11 +617,11 @@ void MainWindow::download_fail(QString errorMessage)
 {
     log(errorMessage);
     ui->progressBar->hide();
-    ui->progressBar->setValue(0);
+    progressTracker->reset();
 
     if (preparing)
     {
-        prepareFailed("XMage download failed");
+        prepareTaskFailed("xmage", "XMage download failed");
     }
     else
     {
@@ -498,17 +632,21 @@ void MainWindow::download_fail(QString errorMessage)
 void MainWindow::download_success(QString installLocation)
 {
     log("XMage installed to: " + installLocation);
-    ui->progressBar->setValue(0);
-    ui->progressBar->setFormat("%p%");
+    if (!xmageDownloadVersion.isEmpty())
+    {
+        setInstalledXmageVersion(xmageDownloadVersion);
+        xmageDownloadVersion.clear();
+    }
+    progressTracker->setDetail(QString());
 
     if (preparing)
     {
-        // Continue to next step in preparation chain
-        prepareStepDecks();
+        prepareTaskDone("xmage");
     }
     else
     {
         ui->progressBar->hide();
+        progressTracker->reset();
         setButtonsEnabled(true);
         updateLaunchReadiness();
     }
@@ -518,118 +656,137 @@ void MainWindow::download_success(QString installLocation)
 // Java download
 // =============================================================================
 
-QString MainWindow::getJavaPlatformSuffix()
+QString MainWindow::getPlatformId()
 {
 #if defined(Q_OS_WIN)
-    return "windows-x64.zip";
+    return "windows-x64";
 #elif defined(Q_OS_MACOS)
-    return "macosx-x64.tar.gz";
-#elif defined(Q_OS_LINUX)
-    return "linux-x64.tar.gz";
+    return "macosx-x64";
 #else
-    return "linux-x64.tar.gz";
+    return "linux-x64";
 #endif
 }
 
+QString MainWindow::getJavaPlatformSuffix(const QJsonObject &javaObj)
+{
+    // The config may pick the archive per platform, e.g.
+    // "archives": { "linux-x64": "linux-x64.tar.zst" }
+    QString suffix = javaObj.value("archives").toObject().value(getPlatformId()).toString();
+    if (!suffix.isEmpty())
+    {
+        return suffix;
+    }
+#if defined(Q_OS_WIN)
+    return getPlatformId() + ".zip";
+#else
+    return getPlatformId() + ".tar.gz";
+#endif
+}
+
+QJsonObject MainWindow::xmageBuildInfo(const QJsonObject &config)
+{
+    // "archives": { "linux-x64": { "full": ..., "sha256": ..., "mirrors": [...] } }
+    QJsonObject xmageObj = config.value("XMage").toObject();
+    QJsonObject archive = xmageObj.value("archives").toObject().value(getPlatformId()).toObject();
+    if (archive.value("full").toString().isEmpty())
+    {
+        return xmageObj;
+    }
+    xmageObj.insert("full", archive.value("full"));
+    xmageObj.insert("sha256", archive.value("sha256"));
+    xmageObj.insert("mirrors", archive.value("mirrors"));
+    return xmageObj;
+}
+
 void MainWindow::startJavaDownload()
 {
-    QString platform = getJavaPlatformSuffix();
+    QString platform = javaSuffix;
     QString fullUrl = javaBaseUrl + platform;
     QString fileName = settings->basePath + "/java-" + javaVersion + "-" + platform;
 
     log("Downloading Java " + javaVersion + " from " + fullUrl);
 
-    if (javaNetworkManager == nullptr)
+    ui->progressBar->show();
+
+    javaDownload = new FileDownload(network, QUrl(fullUrl), fileName, this);
+    // Mirrors are listed like "location", without the platform suffix
+    javaDownload->setMirrors(FileDownload::urlList(javaMirrors, platform));
+    if (!javaSha256.isEmpty())
     {
-        javaNetworkManager = new QNetworkAccessManager(this);
+        javaDownload->setExpectedSha256(javaSha256.toLatin1());
     }
     else
     {
-        javaNetworkManager->disconnect();
-    }
-
-    javaSaveFile = new QSaveFile(fileName);
-    if (!javaSaveFile->open(QIODevice::WriteOnly))
-    {
-        javaDownloadFailed("Failed to create file: " + fileName);
-        delete javaSaveFile;
-        javaSaveFile = nullptr;
-        return;
+        javaDownload->setChecksumUrl(QUrl(fullUrl + ".sha256"));
     }
+    connect(javaDownload, &FileDownload::log, this, &MainWindow::log);
+    connect(javaDownload, &FileDownload::throughput, this, &MainWindow::update_throughput);
+    connect(javaDownload, &FileDownload::download_fail, this, [this](QString error) {
+        javaDownload->deleteLater();
+        javaDownload = nullptr;
+        if (javaExtract != nullptr)
+        {
+            disconnect(javaExtract, nullptr, this, nullptr);
+            javaExtract->abort();
+            javaExtract = nullptr;
+        }
+        javaDownloadFailed("Download failed: " + error);
+    });
 
-    ui->progressBar->setValue(0);
-    ui->progressBar->show();
-
-    QUrl url(fullUrl);
-    QNetworkRequest request(url);
-    request.setAttribute(QNetworkRequest::RedirectPolicyAttribute,
-                         QNetworkRequest::NoLessSafeRedirectPolicy);
-
-    connect(javaNetworkManager, &QNetworkAccessManager::finished, this, &MainWindow::onJavaDownloadFinished);
-    javaDownloadReply = javaNetworkManager->get(request);
-    connect(javaDownloadReply, &QNetworkReply::downloadProgress, this, &MainWindow::onJavaDownloadProgress);
-    connect(javaDownloadReply, &QNetworkReply::readyRead, this, &MainWindow::onJavaDownloadReadyRead);
-}
-
-void MainWindow::onJavaDownloadProgress(qint64 bytesReceived, qint64 bytesTotal)
-{
-    if (bytesTotal > 0)
+    if (TarStreamThread::isTarArchive(platform))
     {
-        int percent = static_cast<int>((bytesReceived * 100) / bytesTotal);
-        ui->progressBar->setValue(percent);
-        ui->progressBar->setFormat(QString("Downloading Java... %1 MB / %2 MB")
-                                       .arg(bytesReceived / 1048576.0, 0, 'f', 1)
-                                       .arg(bytesTotal / 1048576.0, 0, 'f', 1));
+        // Unpack the tarball as it arrives instead of saving it and running tar
+        QString extractPath = settings->basePath + "/java";
+        javaExtract = new TarStreamThread(extractPath);
+        javaDownload->setStreamConsumer(javaExtract);
+        connect(javaExtract, &StreamExtractThread::log, this, &MainWindow::log);
+        // The archive is extracted as it arrives, so extraction progress
+        // stands for the download as well
+        progressTracker->addStage(javaExtract, "Downloading and extracting Java");
+        connect(javaExtract, &StreamExtractThread::progress, progressTracker, &ProgressTracker::update);
+        connect(javaExtract, &StreamExtractThread::extract_complete, this, [this](QString location) {
+            javaExtract = nullptr;
+            javaDownload->deleteLater();
+            javaDownload = nullptr;
+            progressTracker->setDetail(QString());
+            javaExtracted(location);
+        });
+        connect(javaExtract, &StreamExtractThread::extract_fail, this, [this](QString error) {
+            javaExtract = nullptr;
+            if (javaDownload != nullptr)
+            {
+                javaDownload->deleteLater();
+                javaDownload = nullptr;
+            }
+            log("Extraction failed: " + error);
+            javaDownloadFailed("Java extraction failed");
+        });
+        connect(javaExtract, &StreamExtractThread::finished, javaExtract, &QObject::deleteLater);
+        connect(javaDownload, &FileDownload::progress, this, [this](qint64, qint64 bytesTotal) {
+            if (javaExtract != nullptr)
+            {
+                javaExtract->setTotalSize(bytesTotal);
+            }
+        });
+        javaExtract->start();
     }
-}
-
-void MainWindow::onJavaDownloadReadyRead()
-{
-    if (javaSaveFile && javaDownloadReply)
+    else
     {
-        javaSaveFile->write(javaDownloadReply->readAll());
+        progressTracker->addStage(javaDownload, "Downloading Java");
+        connect(javaDownload, &FileDownload::progress, progressTracker, &ProgressTracker::update);
+        connect(javaDownload, &FileDownload::download_complete, this, &MainWindow::onJavaDownloadFinished);
     }
+    javaDownload->start();
 }
 
-void MainWindow::onJavaDownloadFinished(QNetworkReply *reply)
+void MainWindow::onJavaDownloadFinished(QString fileName)
 {
-    javaNetworkManager->disconnect();
-    javaDownloadReply = nullptr;
+    javaDownload->deleteLater();
+    javaDownload = nullptr;
+    progressTracker->setDetail(QString());
 
-    if (reply->error() != QNetworkReply::NoError)
-    {
-        if (javaSaveFile)
-        {
-            javaSaveFile->cancelWriting();
-            delete javaSaveFile;
-            javaSaveFile = nullptr;
-        }
-        javaDownloadFailed("Download failed: " + reply->errorString());
-        reply->deleteLater();
-        return;
-    }
-
-    if (javaSaveFile)
-    {
-        javaSaveFile->write(reply->readAll());
-        QString fileName = javaSaveFile->fileName();
-
-        if (javaSaveFile->commit())
-        {
-            log("Download complete. Extracting...");
-            ui->progressBar->setValue(100);
-            ui->progressBar->setFormat("Extracting...");
-            extractJava(fileName);
-        }
-        else
-        {
-            javaDownloadFailed("Failed to save file");
-        }
-        delete javaSaveFile;
-        javaSaveFile = nullptr;
-    }
-
-    reply->deleteLater();
+    log("Download complete. Extracting...");
+    extractJava(fileName);
 }
 
 void MainWindow::extractJava(const QString &filePath)
@@ -637,85 +794,63 @@ void MainWindow::extractJava(const QString &filePath)
     QString extractPath = settings->basePath + "/java";
     QDir().mkpath(extractPath);
 
-#if defined(Q_OS_WIN)
-    ZipExtractThread *extractThread = new ZipExtractThread(filePath, extractPath);
-    connect(extractThread, &ZipExtractThread::log, this, &MainWindow::log);
-    connect(extractThread, &ZipExtractThread::progress, this, &MainWindow::update_progress_bar);
-    connect(extractThread, &ZipExtractThread::extractComplete,
-            this, [this, filePath, extractPath](QString) {
-                QDir dir(extractPath);
-                QStringList entries = dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
-                QString javaExe = extractPath;
-                if (!entries.isEmpty())
-                {
-                    javaExe = extractPath + "/" + entries.first() + "/bin/java.exe";
-                }
-                log("Java extracted to: " + extractPath);
-                log("Setting Java path to: " + javaExe);
-                settings->setJavaInstallLocation(javaExe);
-                javaDownloadComplete();
+    UnzipThread *extractThread = new UnzipThread(filePath, extractPath, false);
+    connect(extractThread, &UnzipThread::log, this, &MainWindow::log);
+    progressTracker->addStage(extractThread, "Extracting Java");
+    connect(extractThread, &UnzipThread::progress, progressTracker, &ProgressTracker::update);
+    connect(extractThread, &UnzipThread::unzip_complete,
+            this, [this, filePath](QString extractedPath) {
+                javaExtracted(extractedPath);
                 QFile::remove(filePath);
             });
-    connect(extractThread, &ZipExtractThread::extractFailed,
+    connect(extractThread, &UnzipThread::unzip_fail,
             this, [this, filePath](QString error) {
                 log("Extraction failed: " + error);
                 javaDownloadFailed("Java extraction failed");
                 QFile::remove(filePath);
             });
-    connect(extractThread, &ZipExtractThread::finished, extractThread, &QObject::deleteLater);
+    connect(extractThread, &UnzipThread::finished, extractThread, &QObject::deleteLater);
     extractThread->start();
-#else
-    QProcess *process = new QProcess(this);
-    connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            this, [this, process, filePath, extractPath](int exitCode, QProcess::ExitStatus) {
-                if (exitCode == 0)
-                {
-                    QDir dir(extractPath);
-                    QStringList entries = dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
-                    QString jrePath = extractPath;
-                    if (!entries.isEmpty())
-                    {
-                        jrePath = extractPath + "/" + entries.first();
+}
+
+void MainWindow::javaExtracted(const QString &extractPath)
+{
+    QDir dir(extractPath);
+    QStringList entries = dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    QString jrePath = extractPath;
+    if (!entries.isEmpty())
+    {
+        jrePath = extractPath + "/" + entries.first();
 #if defined(Q_OS_MACOS)
-                        if (QDir(jrePath + "/Contents/Home").exists())
-                        {
-                            jrePath = jrePath + "/Contents/Home";
-                        }
+        if (QDir(jrePath + "/Contents/Home").exists())
+        {
+            jrePath = jrePath + "/Contents/Home";
+        }
 #endif
-                    }
-                    QString javaExe = jrePath + "/bin/java";
-                    log("Java extracted to: " + jrePath);
-                    log("Setting Java path to: " + javaExe);
-                    settings->setJavaInstallLocation(javaExe);
-                    javaDownloadComplete();
-                }
-                else
-                {
-                    log("Extraction failed");
-                    javaDownloadFailed("Java extraction failed");
-                }
-                QFile::remove(filePath);
-                process->deleteLater();
-            });
-
-    process->start("tar", QStringList() << "-xzf" << filePath << "-C" << extractPath);
+    }
+#if defined(Q_OS_WIN)
+    QString javaExe = jrePath + "/bin/java.exe";
+#else
+    QString javaExe = jrePath + "/bin/java";
 #endif
+    log("Java extracted to: " + jrePath);
+    log("Setting Java path to: " + javaExe);
+    settings->setJavaInstallLocation(javaExe);
+    javaDownloadComplete();
 }
 
 void MainWindow::javaDownloadComplete()
 {
     javaDownloading = false;
-    ui->progressBar->setFormat("%p%");
 
     if (preparing)
     {
-        // Continue to next step in preparation chain
-        prepareStepXmage();
+        prepareTaskDone("java");
     }
     else
     {
         ui->progressBar->hide();
-        ui->progressBar->setValue(0);
+        progressTracker->reset();
         setButtonsEnabled(true);
     }
 }
@@ -724,16 +859,16 @@ void MainWindow::javaDownloadFailed(const QString &error)
 {
     log("Java download error: " + error);
     javaDownloading = false;
+    progressTracker->setDetail(QString());
 
     if (preparing)
     {
-        prepareFailed("Java download failed");
+        prepareTaskFailed("java", "Java download failed");
     }
     else
     {
         ui->progressBar->hide();
-        ui->progressBar->setValue(0);
-        ui->progressBar->setFormat("%p%");
+        progressTracker->reset();
         setButtonsEnabled(true);
     }
 }
@@ -742,165 +877,61 @@ void MainWindow::javaDownloadFailed(const QString &error)
 // Decks download
 // =============================================================================
 
-void MainWindow::onDecksDownloadProgress(qint64 bytesReceived, qint64 bytesTotal)
+void MainWindow::onDecksDownloadFailed(QString errorMessage)
 {
-    if (bytesTotal > 0)
-    {
-        int percent = static_cast<int>((bytesReceived * 100) / bytesTotal);
-        ui->progressBar->setValue(percent);
-        ui->progressBar->setFormat(QString("Downloading decks... %1 MB / %2 MB")
-                                       .arg(bytesReceived / 1048576.0, 0, 'f', 1)
-                                       .arg(bytesTotal / 1048576.0, 0, 'f', 1));
-    }
+    decksDownload->deleteLater();
+    decksDownload = nullptr;
+    log("Decks download failed: " + errorMessage);
+    decksDownloading = false;
+
+    // Decks are optional, the launch does not wait for them
+    log("Continuing without decks...");
+    prepareTaskFailed("decks", errorMessage);
 }
 
-void MainWindow::onDecksDownloadReadyRead()
+void MainWindow::onDecksDownloadFinished(QString fileName)
 {
-    if (decksSaveFile && decksDownloadReply)
-    {
-        decksSaveFile->write(decksDownloadReply->readAll());
-    }
-}
-
-void MainWindow::onDecksDownloadFinished(QNetworkReply *reply)
-{
-    decksNetworkManager->disconnect();
-    decksDownloadReply = nullptr;
-
-    if (reply->error() != QNetworkReply::NoError)
-    {
-        if (decksSaveFile)
-        {
-            decksSaveFile->cancelWriting();
-            delete decksSaveFile;
-            decksSaveFile = nullptr;
-        }
-        log("Decks download failed: " + reply->errorString());
+    decksDownload->deleteLater();
+    decksDownload = nullptr;
+
+    log("Download complete. Extracting decks...");
+
+    // The old decks folder is swapped out whole and goes to the trash, which
+    // is emptied in the background once the launch is ready
+    UnzipThread *unzip = new UnzipThread(fileName, settings->basePath, false, QStringList() << "decks");
+    connect(unzip, &UnzipThread::log, this, &MainWindow::log);
+    progressTracker->addStage(unzip, "Extracting decks");
+    connect(unzip, &UnzipThread::progress, progressTracker, &ProgressTracker::update);
+    connect(unzip, &UnzipThread::unzip_fail, this, [this, fileName](QString error) {
+        log("Decks extraction failed: " + error);
         decksDownloading = false;
-        reply->deleteLater();
-
-        if (preparing)
-        {
-            // Decks are optional — continue to launch anyway
-            log("Continuing without decks...");
-            preparing = false;
-            ui->progressBar->hide();
-            ui->progressBar->setValue(0);
-            ui->progressBar->setFormat("%p%");
-            setButtonsEnabled(true);
-
-            if (pendingLaunch)
-            {
-                auto launch = pendingLaunch;
-                pendingLaunch = nullptr;
-                launch();
-            }
-        }
-        return;
-    }
-
-    if (decksSaveFile)
-    {
-        decksSaveFile->write(reply->readAll());
-        QString fileName = decksSaveFile->fileName();
-
-        if (decksSaveFile->commit())
-        {
-            log("Download complete. Extracting decks...");
-            ui->progressBar->setValue(100);
-            ui->progressBar->setFormat("Extracting...");
-
-            // Clean old decks before extracting
-            QDir(settings->basePath + "/decks").removeRecursively();
-
-            UnzipThread *unzip = new UnzipThread(fileName, settings->basePath, false);
-            connect(unzip, &UnzipThread::log, this, &MainWindow::log);
-            connect(unzip, &UnzipThread::progress, this, &MainWindow::update_progress_bar);
-            connect(unzip, &UnzipThread::unzip_fail, this, [this, fileName](QString error) {
-                log("Decks extraction failed: " + error);
-                decksDownloading = false;
-                QFile::remove(fileName);
-
-                if (preparing)
-                {
-                    // Decks are optional — continue to launch anyway
-                    log("Continuing without decks...");
-                    preparing = false;
-                    ui->progressBar->hide();
-                    ui->progressBar->setValue(0);
-                    ui->progressBar->setFormat("%p%");
-                    setButtonsEnabled(true);
-
-                    if (pendingLaunch)
-                    {
-                        auto launch = pendingLaunch;
-                        pendingLaunch = nullptr;
-                        launch();
-                    }
-                }
-            });
-            connect(unzip, &UnzipThread::unzip_complete, this, [this, fileName](QString location) {
-                log("Metagame decks installed to: " + location);
-                decksDownloading = false;
-                QFile::remove(fileName);
-
-                if (preparing)
-                {
-                    // All done — launch!
-                    preparing = false;
-                    ui->progressBar->hide();
-                    ui->progressBar->setValue(0);
-                    ui->progressBar->setFormat("%p%");
-                    setButtonsEnabled(true);
-
-                    if (pendingLaunch)
-                    {
-                        auto launch = pendingLaunch;
-                        pendingLaunch = nullptr;
-                        launch();
-                    }
-                }
-            });
-            connect(unzip, &UnzipThread::finished, unzip, &QObject::deleteLater);
-            unzip->start();
-        }
-        else
-        {
-            log("Failed to save decks file");
-            decksDownloading = false;
-
-            if (preparing)
-            {
-                log("Continuing without decks...");
-                preparing = false;
-                ui->progressBar->hide();
-                ui->progressBar->setValue(0);
-                ui->progressBar->setFormat("%p%");
-                setButtonsEnabled(true);
-
-                if (pendingLaunch)
-                {
-                    auto launch = pendingLaunch;
-                    pendingLaunch = nullptr;
-                    launch();
-                }
-            }
-        }
-        delete decksSaveFile;
-        decksSaveFile = nullptr;
-    }
-
-    reply->deleteLater();
+        QFile::remove(fileName);
+        log("Continuing without decks...");
+        prepareTaskFailed("decks", error);
+    });
+    connect(unzip, &UnzipThread::unzip_complete, this, [this, fileName](QString location) {
+        log("Metagame decks installed to: " + location);
+        decksDownloading = false;
+        QFile::remove(fileName);
+        prepareTaskDone("decks");
+    });
+    connect(unzip, &UnzipThread::finished, unzip, &QObject::deleteLater);
+    unzip->start();
 }
 
 // =============================================================================
 // Utility
 // =============================================================================
 
-void MainWindow::update_progress_bar(qint64 bytesReceived, qint64 bytesTotal)
+ProgressTracker *MainWindow::getProgressTracker() const
 {
-    float percentage = (float)bytesReceived / (float)bytesTotal * 100.0f + 0.5f;
-    ui->progressBar->setValue((int)percentage);
+    return progressTracker;
+}
+
+void MainWindow::update_throughput(QString summary)
+{
+    // Per-connection rates of the active download, shown after the total
+    progressTracker->setDetail(summary);
 }
 
 bool MainWindow::findClientJar(QString *jar)
@@ -924,6 +955,11 @@ bool MainWindow::findClientJar(QString *jar)
         }
     }
 
+    if (!settings->installFilter().includesClient())
+    {
+        log("ERROR: The client is not installed on this machine; change Install components in Settings");
+        return false;
+    }
     log("ERROR: No client jar found in: " + searchPaths.join(" or "));
     return false;
 }
@@ -949,26 +985,56 @@ bool MainWindow::findServerJar(QString *jar)
         }
     }
 
+    if (!settings->installFilter().includesServer())
+    {
+        log("ERROR: The server is not installed on this machine; change Install components in Settings");
+        return false;
+    }
     log("ERROR: No server jar found in: " + searchPaths.join(" or "));
     return false;
 }
 
 void MainWindow::fetchConfig()
 {
-    if (configNetworkManager == nullptr)
+    if (configReply != nullptr)
     {
-        configNetworkManager = new QNetworkAccessManager(this);
+        // Only the latest fetch gets to report back
+        disconnect(configReply, nullptr, this, nullptr);
+        configReply->abort();
+        configReply->deleteLater();
     }
-    else
+
+    QNetworkRequest request = network->request(QUrl(settings->getCurrentBuildUrl()));
+    QJsonObject config;
+    if (loadCachedConfig(&config))
     {
-        configNetworkManager->disconnect();
+        // Conditional GET: an unchanged config costs a 304 and no body
+        QFile validatorsFile(settings->getCurrentBuildInstallPath() + "/config.meta.json");
+        if (validatorsFile.open(QIODevice::ReadOnly))
+        {
+            QJsonObject validators = QJsonDocument::fromJson(validatorsFile.readAll()).object();
+            if (validators.value("url").toString() == settings->getCurrentBuildUrl())
+            {
+                QString etag = validators.value("etag").toString();
+                QString lastModified = validators.value("lastModified").toString();
+                if (!etag.isEmpty())
+                {
+                    request.setRawHeader("If-None-Match", etag.toLatin1());
+                }
+                if (!lastModified.isEmpty())
+                {
+                    request.setRawHeader("If-Modified-Since", lastModified.toLatin1());
+                }
+            }
+        }
     }
+    request.setTransferTimeout(CONFIG_FETCH_TIMEOUT);
 
-    connect(configNetworkManager, &QNetworkAccessManager::finished, this, &MainWindow::onConfigFetched);
-    QNetworkRequest request(QUrl(settings->getCurrentBuildUrl()));
-    request.setAttribute(QNetworkRequest::RedirectPolicyAttribute,
-                         QNetworkRequest::NoLessSafeRedirectPolicy);
-    configNetworkManager->get(request);
+    QNetworkReply *reply = network->get(request);
+    configReply = reply;
+    connect(reply, &QNetworkReply::finished, this, [this, reply]() { onConfigFetched(reply); });
+    // Hard deadline for the whole request, not just between packets
+    QTimer::singleShot(CONFIG_FETCH_TIMEOUT, reply, &QNetworkReply::abort);
 }
 
 void MainWindow::updateBuildInfo()
@@ -1006,9 +1072,7 @@ void MainWindow::openLocalPath(const QString &path)
 
 void MainWindow::updateLaunchReadiness()
 {
-    QString buildPath = settings->getCurrentBuildInstallPath();
-    bool hasXmage = QDir(buildPath + "/mage-client/lib").exists() ||
-                    QDir(buildPath + "/xmage/mage-client/lib").exists();
+    bool hasXmage = isXmageInstalled();
     QFileInfo javaInfo(settings->javaInstallLocation);
     bool hasJava = javaInfo.isExecutable();
 
@@ -1044,3 +1108,102 @@ bool MainWindow::loadCachedConfig(QJsonObject *config)
     *config = doc.object();
     return true;
 }
+
+void MainWindow::startBackgroundUpdate()
+{
+    // First installs happen interactively; this only keeps existing ones current
+    QString buildPath = settings->getCurrentBuildInstallPath();
+    QJsonObject config;
+    if (preparing || !isXmageInstalled() || !loadCachedConfig(&config))
+    {
+        return;
+    }
+
+    QJsonObject xmageObj = xmageBuildInfo(config);
+    QString latest = xmageObj.value("version").toString();
+    QString url = xmageObj.value("full").toString();
+    InstallFilter filter = settings->installFilter();
+    if (updateStager != nullptr)
+    {
+        // Keeps going across launches unless what it stages is no longer wanted
+        if (updateStager->version() == latest && updateStager->profile() == filter.key())
+        {
+            return;
+        }
+        delete updateStager;
+        updateStager = nullptr;
+    }
+    bool current = latest == installedXmageVersion() && installedXmageProfile() == filter.key();
+    if (latest.isEmpty() || url.isEmpty() || current ||
+        (UpdateStager::stagedVersion(buildPath) == latest && UpdateStager::stagedProfile(buildPath) == filter.key()))
+    {
+        return;
+    }
+
+    if (latest == installedXmageVersion())
+    {
+        log("Install components changed, fetching them in the background...");
+    }
+    else
+    {
+        log("XMage " + latest + " is available, downloading it in the background...");
+    }
+    updateStager = new UpdateStager(network, buildPath, this);
+    connect(updateStager, &UpdateStager::log, this, &MainWindow::log);
+    connect(updateStager, &UpdateStager::stage_complete, this, [this](QString version) {
+        log("XMage " + version + " is ready and will be used on the next launch");
+        updateStager->deleteLater();
+        updateStager = nullptr;
+    });
+    connect(updateStager, &UpdateStager::stage_fail, this, [this](QString error) {
+        log("Background update failed: " + error);
+        updateStager->deleteLater();
+        updateStager = nullptr;
+    });
+    updateStager->setMirrors(FileDownload::urlList(xmageObj.value("mirrors")));
+    updateStager->setFilter(filter);
+    updateStager->setManagedDirs(DownloadManager::managedDirs());
+    updateStager->stage(QUrl(url), latest, xmageObj.value("sha256").toString().toLatin1());
+}
+
+bool MainWindow::isXmageInstalled()
+{
+    // Single-role installs only have one of the two halves
+    QString buildPath = settings->getCurrentBuildInstallPath();
+    return QDir(buildPath + "/mage-client/lib").exists() || QDir(buildPath + "/xmage/mage-client/lib").exists() ||
+           QDir(buildPath + "/mage-server/lib").exists() || QDir(buildPath + "/xmage/mage-server/lib").exists();
+}
+
+QString MainWindow::installedXmageProfile()
+{
+    QFile file(settings->getCurrentBuildInstallPath() + "/installed.json");
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return InstallFilter().key();
+    }
+    // Installs from before profiles existed have everything
+    return QJsonDocument::fromJson(file.readAll()).object().value("profile").toString(InstallFilter().key());
+}
+
+QString MainWindow::installedXmageVersion()
+{
+    QFile file(settings->getCurrentBuildInstallPath() + "/installed.json");
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return QString();
+    }
+    return QJsonDocument::fromJson(file.readAll()).object().value("version").toString();
+}
+
+void MainWindow::setInstalledXmageVersion(const QString &version)
+{
+    QJsonObject installed;
+    installed.insert("version", version);
+    installed.insert("profile", settings->installFilter().key());
+    QSaveFile file(settings->getCurrentBuildInstallPath() + "/installed.json");
+    if (file.open(QIODevice::WriteOnly))
+    {
+        file.write(QJsonDocument(installed).toJson());
+        file.commit();
+    }
+}
@@ -9,6 +9,7 @@
 #include <QFileDialog>
 #include <QInputDialog>
 #include <QStandardPaths>
+#include <QTimer>
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QSaveFile>
@@ -18,10 +19,20 @@
 #include <QFile>
 #include <QDir>
 #include <functional>
+#include "filedownload.h"
+#include "logbuffer.h"
+#include "networkservice.h"
+#include "progresstracker.h"
 #include "settingsdialog.h"
+#include "streamextractthread.h"
 #include "settings.h"
+#include "taskgraph.h"
+#include "updatestager.h"
 #include "xmageprocess.h"
 
+#define CONFIG_FETCH_TIMEOUT 10000
+#define BACKGROUND_UPDATE_DELAY 5000
+
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
 QT_END_NAMESPACE
@@ -33,15 +44,23 @@ class MainWindow : public QMainWindow
 public:
     MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
+    ProgressTracker *getProgressTracker() const;
+    // "windows-x64", "macosx-x64" or "linux-x64", the key config.json uses
+    // for per-platform archives
+    static QString getPlatformId();
+    // The config's XMage entry with this platform's archive, if it
+    // advertises one, in place of the default full/sha256/mirrors
+    static QJsonObject xmageBuildInfo(const QJsonObject &config);
 
 public slots:
-    void update_progress_bar(qint64 bytesReceived, qint64 bytesTotal);
+    void update_throughput(QString summary);
     void log(QString message);
     void download_fail(QString errorMessage);
     void download_success(QString installLocation);
 
 protected:
     void closeEvent(QCloseEvent *event) override;
+    void changeEvent(QEvent *event) override;
 
 private slots:
     void on_clientButton_clicked();
@@ -53,45 +72,48 @@ private slots:
     void openLocalPath(const QString &path);
 
     // Java download slots
-    void onJavaDownloadProgress(qint64 bytesReceived, qint64 bytesTotal);
-    void onJavaDownloadFinished(QNetworkReply *reply);
-    void onJavaDownloadReadyRead();
+    void onJavaDownloadFinished(QString fileName);
 
     // Config fetch slot
     void onConfigFetched(QNetworkReply *reply);
 
     // Decks download slots
-    void onDecksDownloadProgress(qint64 bytesReceived, qint64 bytesTotal);
-    void onDecksDownloadFinished(QNetworkReply *reply);
-    void onDecksDownloadReadyRead();
+    void onDecksDownloadFinished(QString fileName);
+    void onDecksDownloadFailed(QString errorMessage);
 
 private:
     Ui::MainWindow *ui;
     QLabel *background;
     Settings *settings;
+    LogBuffer *logBuffer;
+    NetworkService *network;
+    ProgressTracker *progressTracker;
     XMageProcess *clientProcess = nullptr;
     XMageProcess *serverProcess = nullptr;
 
     // Java download members
-    QNetworkAccessManager *javaNetworkManager = nullptr;
-    QNetworkReply *javaDownloadReply = nullptr;
-    QSaveFile *javaSaveFile = nullptr;
+    FileDownload *javaDownload = nullptr;
+    StreamExtractThread *javaExtract = nullptr;
     QString javaBaseUrl;
+    QJsonValue javaMirrors;
     QString javaVersion;
+    QString javaSha256;
+    QString javaSuffix;
+    QString xmageDownloadVersion;
+    UpdateStager *updateStager = nullptr;
     bool javaDownloading = false;
 
     // Config fetch members
-    QNetworkAccessManager *configNetworkManager = nullptr;
+    QNetworkReply *configReply = nullptr;
     bool configFetching = false;
 
     // Decks download members
-    QNetworkAccessManager *decksNetworkManager = nullptr;
-    QNetworkReply *decksDownloadReply = nullptr;
-    QSaveFile *decksSaveFile = nullptr;
+    FileDownload *decksDownload = nullptr;
     bool decksDownloading = false;
 
     // Launch preparation chain
     std::function<void()> pendingLaunch;
+    TaskGraph *prepareGraph = nullptr;
     bool preparing = false;
 
     void prepareLaunch(std::function<void()> onReady);
@@ -99,6 +121,9 @@ private:
     void prepareStepJava();
     void prepareStepXmage();
     void prepareStepDecks();
+    void prepareTaskDone(const QString &task);
+    void prepareTaskFailed(const QString &task, const QString &error);
+    void prepareReady();
     void prepareFailed(const QString &error);
     void setButtonsEnabled(bool enabled);
 
@@ -112,8 +137,9 @@ private:
     // Java download methods
     void startJavaDownload();
     void startXmageDownload(const QJsonObject &config);
-    QString getJavaPlatformSuffix();
+    QString getJavaPlatformSuffix(const QJsonObject &javaObj);
     void extractJava(const QString &filePath);
+    void javaExtracted(const QString &extractPath);
     void javaDownloadComplete();
     void javaDownloadFailed(const QString &error);
 
@@ -122,5 +148,10 @@ private:
     void updateLaunchReadiness();
     void updateBuildInfo();
     bool loadCachedConfig(QJsonObject *config);
+    bool isXmageInstalled();
+    QString installedXmageVersion();
+    QString installedXmageProfile();
+    void startBackgroundUpdate();
+    void setInstalledXmageVersion(const QString &version);
 };
 #endif // MAINWINDOW_H
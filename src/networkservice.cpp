@@ -0,0 +1,89 @@
+#include "networkservice.h"
+
+NetworkService::NetworkService(QObject *parent)
+    : QObject(parent)
+    , networkManager(new QNetworkAccessManager(this))
+    , transferScheduler(new TransferScheduler(this))
+    , sslConfiguration(QSslConfiguration::defaultConfiguration())
+{
+    // Keep sessions as tickets so they can be handed to new connections
+    sslConfiguration.setSslOption(QSsl::SslOptionDisableSessionTickets, false);
+    sslConfiguration.setSslOption(QSsl::SslOptionDisableSessionPersistence, false);
+    sslConfiguration.setAllowedNextProtocols(QList<QByteArray>()
+                                             << QSslConfiguration::ALPNProtocolHTTP2
+                                             << QSslConfiguration::NextProtocolHttp1_1);
+}
+
+QNetworkAccessManager *NetworkService::manager() const
+{
+    return networkManager;
+}
+
+TransferScheduler *NetworkService::scheduler() const
+{
+    return transferScheduler;
+}
+
+QNetworkRequest NetworkService::request(const QUrl &url) const
+{
+    QNetworkRequest request(url);
+    request.setAttribute(QNetworkRequest::RedirectPolicyAttribute,
+                         QNetworkRequest::NoLessSafeRedirectPolicy);
+    // HTTP/1.1 connections are kept alive by default
+    request.setAttribute(QNetworkRequest::Http2AllowedAttribute, true);
+    request.setTransferTimeout(NETWORK_TRANSFER_TIMEOUT);
+    if (url.scheme() == "https")
+    {
+        QSslConfiguration config = sslConfiguration;
+        QByteArray ticket = sessionTickets.value(url.host());
+        if (!ticket.isEmpty())
+        {
+            config.setSessionTicket(ticket);
+        }
+        request.setSslConfiguration(config);
+    }
+    return request;
+}
+
+QNetworkReply *NetworkService::get(const QNetworkRequest &request)
+{
+    QNetworkReply *reply = networkManager->get(request);
+    track(reply);
+    return reply;
+}
+
+QNetworkReply *NetworkService::head(const QNetworkRequest &request)
+{
+    QNetworkReply *reply = networkManager->head(request);
+    track(reply);
+    return reply;
+}
+
+void NetworkService::track(QNetworkReply *reply)
+{
+    // Redirects land on other hosts (GitHub releases go to a CDN), so the
+    // ticket is stored under the host that actually served the reply
+    connect(reply, &QNetworkReply::encrypted, this, [this, reply]() {
+        QByteArray ticket = reply->sslConfiguration().sessionTicket();
+        if (!ticket.isEmpty())
+        {
+            sessionTickets.insert(reply->url().host(), ticket);
+        }
+    });
+}
+
+void NetworkService::preconnect(const QUrl &url)
+{
+    if (!url.isValid() || url.host().isEmpty())
+    {
+        return;
+    }
+    if (url.scheme() == "https")
+    {
+        networkManager->connectToHostEncrypted(url.host(), url.port(443), sslConfiguration);
+    }
+    else
+    {
+        networkManager->connectToHost(url.host(), url.port(80));
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef NETWORKSERVICE_H
+#define NETWORKSERVICE_H
+
+#include <QHash>
+#include <QObject>
+#include <QUrl>
+#include <QtNetwork/QNetworkAccessManager>
+#include <QtNetwork/QNetworkReply>
+#include <QtNetwork/QNetworkRequest>
+#include <QtNetwork/QSslConfiguration>
+#include "transferscheduler.h"
+
+// Requests abort after this long without receiving any data
+#define NETWORK_TRANSFER_TIMEOUT 30000
+
+// The launcher's single QNetworkAccessManager. Sharing it lets config
+// fetches and downloads reuse pooled keep-alive connections, DNS results
+// and HTTP/2 sessions instead of each download paying for its own
+// handshakes. TLS session tickets are remembered per host so reconnects
+// (and the parallel segment connections) resume rather than renegotiate.
+class NetworkService : public QObject
+{
+    Q_OBJECT
+public:
+    NetworkService(QObject *parent = nullptr);
+    QNetworkAccessManager *manager() const;
+    TransferScheduler *scheduler() const;
+    QNetworkRequest request(const QUrl &url) const;
+    QNetworkReply *get(const QNetworkRequest &request);
+    QNetworkReply *head(const QNetworkRequest &request);
+    // Opens (and TLS-handshakes) a connection to url's host ahead of the
+    // first request
+    void preconnect(const QUrl &url);
+
+private:
+    QNetworkAccessManager *networkManager;
+    TransferScheduler *transferScheduler;
+    QSslConfiguration sslConfiguration;
+    QHash<QString, QByteArray> sessionTickets;
+
+    void track(QNetworkReply *reply);
+};
+
+#endif // NETWORKSERVICE_H
@@ -0,0 +1,140 @@
+#include "progresstracker.h"
+#include <QStringList>
+
+ProgressTracker::ProgressTracker(QProgressBar *progressBar, QObject *parent)
+    : QObject(parent)
+    , updateTimer(new QTimer(this))
+{
+    this->progressBar = progressBar;
+    updateTimer->setInterval(PROGRESS_UPDATE_INTERVAL);
+    connect(updateTimer, &QTimer::timeout, this, &ProgressTracker::push);
+}
+
+void ProgressTracker::addStage(QObject *source, const QString &label)
+{
+    Stage stage;
+    stage.source = source;
+    stage.label = label;
+    stages.append(stage);
+    if (!paused && !updateTimer->isActive())
+    {
+        rateClock.start();
+        updateTimer->start();
+    }
+}
+
+void ProgressTracker::reset()
+{
+    stages.clear();
+    detail.clear();
+    lastDone = 0;
+    rate = 0;
+    updateTimer->stop();
+    progressBar->setValue(0);
+    progressBar->setFormat("%p%");
+}
+
+void ProgressTracker::setPaused(bool paused)
+{
+    this->paused = paused;
+    if (paused)
+    {
+        updateTimer->stop();
+    }
+    else if (!stages.isEmpty() && !updateTimer->isActive())
+    {
+        push();
+        updateTimer->start();
+    }
+}
+
+void ProgressTracker::setDetail(const QString &detail)
+{
+    this->detail = detail;
+}
+
+void ProgressTracker::update(qint64 done, qint64 total)
+{
+    QObject *source = sender();
+    for (Stage &stage : stages)
+    {
+        if (stage.source == source)
+        {
+            stage.done = done;
+            stage.total = total;
+            return;
+        }
+    }
+}
+
+void ProgressTracker::push()
+{
+    // A stage whose source went away before finishing was abandoned
+    // (e.g. a stream replaced by a file download); drop its bytes
+    for (int i = stages.size() - 1; i >= 0; i--)
+    {
+        if (stages[i].source.isNull() && (stages[i].total < 0 || stages[i].done < stages[i].total))
+        {
+            stages.removeAt(i);
+        }
+    }
+
+    qint64 done = 0;
+    qint64 total = 0;
+    QStringList active;
+    for (const Stage &stage : std::as_const(stages))
+    {
+        if (stage.total > 0)
+        {
+            done += qMin(stage.done, stage.total);
+            total += stage.total;
+        }
+        if (!stage.source.isNull() && (stage.total < 0 || stage.done < stage.total))
+        {
+            active << stage.label;
+        }
+    }
+
+    qint64 elapsed = rateClock.restart();
+    if (elapsed > 0 && done >= lastDone)
+    {
+        double current = (done - lastDone) * 1000.0 / elapsed;
+        rate = rate <= 0 ? current : rate + PROGRESS_RATE_SMOOTHING * (current - rate);
+    }
+    lastDone = done;
+    if (active.isEmpty())
+    {
+        // Everything finished; addStage() starts the timer again
+        updateTimer->stop();
+    }
+
+    int value = total > 0 ? static_cast<int>(done * 100 / total) : 0;
+    if (progressBar->value() != value)
+    {
+        progressBar->setValue(value);
+    }
+
+    QStringList parts;
+    if (!active.isEmpty())
+    {
+        parts << active.join(", ");
+    }
+    if (rate >= 1024 && !active.isEmpty())
+    {
+        parts << QString("%1 MB/s").arg(rate / 1048576.0, 0, 'f', 1);
+        qint64 seconds = static_cast<qint64>((total - done) / rate);
+        if (total > done)
+        {
+            parts << QString("%1:%2 left").arg(seconds / 60).arg(seconds % 60, 2, 10, QChar('0'));
+        }
+    }
+    if (!detail.isEmpty())
+    {
+        parts << detail;
+    }
+    QString format = parts.isEmpty() ? "%p%" : "%p%  (" + parts.join(" - ") + ")";
+    if (progressBar->format() != format)
+    {
+        progressBar->setFormat(format);
+    }
+}
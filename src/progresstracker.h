@@ -0,0 +1,59 @@
+#ifndef PROGRESSTRACKER_H
+#define PROGRESSTRACKER_H
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QProgressBar>
+#include <QString>
+#include <QTimer>
+
+#define PROGRESS_UPDATE_INTERVAL 100
+#define PROGRESS_RATE_SMOOTHING 0.3
+
+// Combines the progress of every running stage (downloads, extractions)
+// into the one progress bar. Stages are weighted by their byte counts, so
+// a large download dominates a small one. Sources report through update(),
+// which only records the numbers; the bar, throughput and ETA are refreshed
+// on a PROGRESS_UPDATE_INTERVAL timer, and not at all while paused.
+class ProgressTracker : public QObject
+{
+    Q_OBJECT
+public:
+    ProgressTracker(QProgressBar *progressBar, QObject *parent = nullptr);
+    // Starts a stage fed by source's progress signal
+    void addStage(QObject *source, const QString &label);
+    // Forgets all stages, e.g. at the start of a new launch
+    void reset();
+    void setPaused(bool paused);
+    // Extra text shown after the rate, such as per-connection speeds
+    void setDetail(const QString &detail);
+
+public slots:
+    // Connect a source's progress(done, total) signal here
+    void update(qint64 done, qint64 total);
+
+private:
+    struct Stage
+    {
+        QPointer<QObject> source;
+        QString label;
+        qint64 done = 0;
+        qint64 total = -1;
+    };
+
+    QProgressBar *progressBar;
+    QTimer *updateTimer;
+    QElapsedTimer rateClock;
+    QList<Stage> stages;
+    QString detail;
+    qint64 lastDone = 0;
+    double rate = 0;
+    bool paused = false;
+
+private slots:
+    void push();
+};
+
+#endif // PROGRESSTRACKER_H
@@ -0,0 +1,273 @@
+#include "sessionlogwriter.h"
+#include <QDir>
+#include <QFileInfo>
+#include <zstd.h>
+
+#define SESSION_LOG_COMPRESS_CHUNK (1024 * 1024)
+
+SessionLogWriter::SessionLogWriter(const QString &dir, const QString &name)
+{
+    this->dir = dir;
+    this->name = name;
+    sessionStamp = QDateTime::currentDateTime().toString("yyyyMMdd-HHmmss");
+}
+
+void SessionLogWriter::append(const QString &line)
+{
+    append(QStringList(line));
+}
+
+void SessionLogWriter::append(const QStringList &lines)
+{
+    if (lines.isEmpty())
+    {
+        return;
+    }
+    // Encode before taking the lock, the writer only ever waits on a swap
+    QByteArray data = lines.join('\n').toUtf8();
+    data += '\n';
+
+    QMutexLocker locker(&mutex);
+    if (inputFinished || failed)
+    {
+        return;
+    }
+    if (queued.size() + data.size() > SESSION_LOG_QUEUE_LIMIT)
+    {
+        dropped += lines.size();
+        return;
+    }
+    if (dropped > 0)
+    {
+        queued += QString("[%1 lines were not saved, the disk could not keep up]\n").arg(dropped).toUtf8();
+        dropped = 0;
+    }
+    queued += data;
+    if (queued.size() >= SESSION_LOG_BATCH_SIZE)
+    {
+        dataAvailable.wakeOne();
+    }
+}
+
+void SessionLogWriter::finish()
+{
+    QMutexLocker locker(&mutex);
+    inputFinished = true;
+    dataAvailable.wakeOne();
+}
+
+void SessionLogWriter::stop(const QString &errorMessage)
+{
+    {
+        QMutexLocker locker(&mutex);
+        failed = true;
+        queued.clear();
+    }
+    if (!errorMessage.isEmpty())
+    {
+        emit write_fail(errorMessage);
+    }
+}
+
+void SessionLogWriter::run()
+{
+    if (!QDir().mkpath(dir))
+    {
+        stop("Failed to create log folder " + dir);
+        return;
+    }
+    compressLeftovers();
+    prune();
+    if (!openPart())
+    {
+        stop(QString());
+        return;
+    }
+
+    while (true)
+    {
+        QByteArray batch;
+        bool last;
+        {
+            QMutexLocker locker(&mutex);
+            if (queued.size() < SESSION_LOG_BATCH_SIZE && !inputFinished)
+            {
+                dataAvailable.wait(&mutex, SESSION_LOG_FLUSH_INTERVAL);
+            }
+            if (inputFinished && dropped > 0)
+            {
+                queued += QString("[%1 lines were not saved, the disk could not keep up]\n").arg(dropped).toUtf8();
+                dropped = 0;
+            }
+            batch.swap(queued);
+            last = inputFinished;
+        }
+
+        // Flushed every batch, so a crash loses at most one interval
+        if (!batch.isEmpty() && (file.write(batch) != batch.size() || !file.flush()))
+        {
+            file.close();
+            stop("Error writing to file " + file.fileName());
+            return;
+        }
+        if (last)
+        {
+            break;
+        }
+        if (file.size() >= SESSION_LOG_ROTATE_SIZE || opened.secsTo(QDateTime::currentDateTimeUtc()) >= SESSION_LOG_ROTATE_AGE)
+        {
+            closePart();
+            prune();
+            if (!openPart())
+            {
+                stop(QString());
+                return;
+            }
+        }
+    }
+    closePart();
+    prune();
+}
+
+bool SessionLogWriter::openPart()
+{
+    // Never reuse a name, in case a session of the same name started within
+    // the same second
+    QString base;
+    do
+    {
+        part++;
+        base = QString("%1/%2-%3-%4.log").arg(dir, name, sessionStamp).arg(part);
+    } while (QFile::exists(base) || QFile::exists(base + ".zst"));
+
+    file.setFileName(base);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        emit write_fail("Failed to open file " + base);
+        return false;
+    }
+    opened = QDateTime::currentDateTimeUtc();
+    return true;
+}
+
+void SessionLogWriter::closePart()
+{
+    QString source = file.fileName();
+    bool empty = file.size() == 0;
+    file.close();
+    if (empty)
+    {
+        QFile::remove(source);
+        return;
+    }
+    QString error;
+    if (!compress(source, source + ".zst", &error))
+    {
+        // Keep the plain log, the next session tries again
+        QFile::remove(source + ".zst");
+        emit write_fail(error);
+        return;
+    }
+    QFile::remove(source);
+}
+
+void SessionLogWriter::compressLeftovers()
+{
+    QDir logDir(dir);
+    for (const QString &leftover : logDir.entryList(QStringList() << name + "-*.log", QDir::Files))
+    {
+        QString source = logDir.filePath(leftover);
+        QString error;
+        if (compress(source, source + ".zst", &error))
+        {
+            QFile::remove(source);
+        }
+        else
+        {
+            QFile::remove(source + ".zst");
+            emit write_fail(error);
+        }
+    }
+}
+
+void SessionLogWriter::prune()
+{
+    QDateTime oldest = QDateTime::currentDateTime().addDays(-SESSION_LOG_KEEP_DAYS);
+    qint64 kept = 0;
+    // Newest first
+    for (const QFileInfo &info : QDir(dir).entryInfoList(QStringList() << "*.log.zst", QDir::Files, QDir::Time))
+    {
+        kept += info.size();
+        if (kept > SESSION_LOG_KEEP_BYTES || info.lastModified() < oldest)
+        {
+            QFile::remove(info.filePath());
+        }
+    }
+}
+
+bool SessionLogWriter::compress(const QString &source, const QString &target, QString *error)
+{
+    QFile in(source);
+    QFile out(target);
+    if (!in.open(QIODevice::ReadOnly))
+    {
+        *error = "Failed to open file " + source;
+        return false;
+    }
+    if (!out.open(QIODevice::WriteOnly))
+    {
+        *error = "Failed to open file " + target;
+        return false;
+    }
+
+    ZSTD_CCtx *context = ZSTD_createCCtx();
+    if (context == nullptr)
+    {
+        *error = "Error initializing zstd encoder";
+        return false;
+    }
+    ZSTD_CCtx_setParameter(context, ZSTD_c_compressionLevel, SESSION_LOG_ZSTD_LEVEL);
+    QByteArray buffer(static_cast<int>(ZSTD_CStreamOutSize()), Qt::Uninitialized);
+    bool ok = true;
+    bool last = false;
+    while (ok && !last)
+    {
+        QByteArray data = in.read(SESSION_LOG_COMPRESS_CHUNK);
+        if (data.isEmpty() && !in.atEnd())
+        {
+            *error = "Error reading file " + source;
+            ok = false;
+            break;
+        }
+        last = in.atEnd();
+        ZSTD_inBuffer input = { data.constData(), static_cast<size_t>(data.size()), 0 };
+        ZSTD_EndDirective mode = last ? ZSTD_e_end : ZSTD_e_continue;
+        bool done = false;
+        while (!done)
+        {
+            ZSTD_outBuffer output = { buffer.data(), static_cast<size_t>(buffer.size()), 0 };
+            size_t remaining = ZSTD_compressStream2(context, &output, &input, mode);
+            if (ZSTD_isError(remaining))
+            {
+                *error = QString("Error compressing %1: %2").arg(source, ZSTD_getErrorName(remaining));
+                ok = false;
+                break;
+            }
+            if (out.write(buffer.constData(), output.pos) != static_cast<qint64>(output.pos))
+            {
+                *error = "Error writing to file " + target;
+                ok = false;
+                break;
+            }
+            // The end directive is done once the frame is flushed
+            done = last ? remaining == 0 : input.pos == input.size;
+        }
+    }
+    ZSTD_freeCCtx(context);
+    if (ok && !out.flush())
+    {
+        *error = "Error writing to file " + target;
+        ok = false;
+    }
+    return ok;
+}
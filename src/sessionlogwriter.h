@@ -0,0 +1,74 @@
+#ifndef SESSIONLOGWRITER_H
+#define SESSIONLOGWRITER_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QFile>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QThread>
+#include <QWaitCondition>
+
+// Queued output is written once this much piles up, or every interval
+#define SESSION_LOG_BATCH_SIZE (64 * 1024)
+#define SESSION_LOG_FLUSH_INTERVAL 1000
+// Beyond this much unwritten output new lines are dropped, not waited for
+#define SESSION_LOG_QUEUE_LIMIT (8 * 1024 * 1024)
+#define SESSION_LOG_ROTATE_SIZE (32 * 1024 * 1024)
+#define SESSION_LOG_ROTATE_AGE (6 * 60 * 60)
+// Compressed logs are removed past either limit, oldest first
+#define SESSION_LOG_KEEP_BYTES (256 * 1024 * 1024)
+#define SESSION_LOG_KEEP_DAYS 30
+#define SESSION_LOG_ZSTD_LEVEL 3
+
+// Saves the output of one client or server session to dir as
+// <name>-<start time>-<part>.log. A part is closed once it reaches
+// SESSION_LOG_ROTATE_SIZE or SESSION_LOG_ROTATE_AGE, or when the session
+// ends, and is then compressed to .log.zst.
+//
+// append() may be called from any thread and never waits for the disk: if
+// the writer falls behind by SESSION_LOG_QUEUE_LIMIT bytes, lines are
+// dropped and the log says how many. Plain .log parts left behind by a
+// launcher that did not exit cleanly are compressed when the next session
+// of the same name starts. After a write error the thread ends and later
+// lines are dropped; the owner still calls finish() and waits for it.
+class SessionLogWriter : public QThread
+{
+    Q_OBJECT
+public:
+    SessionLogWriter(const QString &dir, const QString &name);
+    void run() override;
+
+    void append(const QString &line);
+    void append(const QStringList &lines);
+    // Writes what is queued, compresses the last part and ends the thread
+    void finish();
+
+signals:
+    void write_fail(QString errorMessage);
+
+private:
+    QString dir;
+    QString name;
+    QString sessionStamp;
+    QMutex mutex;
+    QWaitCondition dataAvailable;
+    QByteArray queued;
+    qint64 dropped = 0;
+    bool inputFinished = false;
+    bool failed = false; // Input is dropped once writing stopped
+
+    QFile file;
+    QDateTime opened;
+    int part = 0;
+
+    void stop(const QString &errorMessage);
+    bool openPart();
+    void closePart();
+    void compressLeftovers();
+    void prune();
+    static bool compress(const QString &source, const QString &target, QString *error);
+};
+
+#endif // SESSIONLOGWRITER_H
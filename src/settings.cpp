@@ -34,6 +34,18 @@ void Settings::loadUserSettings()
     QJsonObject root = doc.object();
     currentBuildName = root.value("currentBuildName").toString("");
     javaInstallLocation = root.value("javaInstallLocation").toString();
+    downloadRateLimit = qMax(0, root.value("downloadRateLimit").toInt(0));
+    installProfile = InstallFilter::profileFromName(root.value("installProfile").toString());
+    installIncludes.clear();
+    for (const QJsonValue &value : root.value("installInclude").toArray())
+    {
+        installIncludes.append(value.toString());
+    }
+    installExcludes.clear();
+    for (const QJsonValue &value : root.value("installExclude").toArray())
+    {
+        installExcludes.append(value.toString());
+    }
 }
 
 void Settings::saveUserSettings()
@@ -41,6 +53,10 @@ void Settings::saveUserSettings()
     QJsonObject root;
     root.insert("currentBuildName", currentBuildName);
     root.insert("javaInstallLocation", javaInstallLocation);
+    root.insert("downloadRateLimit", downloadRateLimit);
+    root.insert("installProfile", InstallFilter::profileName(installProfile));
+    root.insert("installInclude", QJsonArray::fromStringList(installIncludes));
+    root.insert("installExclude", QJsonArray::fromStringList(installExcludes));
 
     QDir().mkpath(basePath);
     QFile file(basePath + "/user-settings.json");
@@ -150,6 +166,26 @@ void Settings::setJavaInstallLocation(QString location)
     saveUserSettings();
 }
 
+void Settings::setDownloadRateLimit(int kilobytesPerSecond)
+{
+    downloadRateLimit = qMax(0, kilobytesPerSecond);
+    saveUserSettings();
+}
+
+void Settings::setInstallSelection(InstallFilter::Profile profile, const QStringList &includes,
+                                   const QStringList &excludes)
+{
+    installProfile = profile;
+    installIncludes = includes;
+    installExcludes = excludes;
+    saveUserSettings();
+}
+
+InstallFilter Settings::installFilter() const
+{
+    return InstallFilter(installProfile, installIncludes, installExcludes);
+}
+
 QString Settings::getCurrentBuildUrl() const
 {
     for (const Build &build : builds)
@@ -8,6 +8,7 @@
 #include <QCoreApplication>
 #include <QStandardPaths>
 #include <QFileInfo>
+#include "installfilter.h"
 
 struct Build {
     QString name;
@@ -19,6 +20,10 @@ class Settings
 public:
     Settings();
     QString javaInstallLocation;
+    int downloadRateLimit = 0;  // KB/s across all downloads, 0 for unlimited
+    InstallFilter::Profile installProfile = InstallFilter::Both;
+    QStringList installIncludes;  // Globs, see InstallFilter
+    QStringList installExcludes;
     QList<Build> builds;
     QString currentBuildName;
     QStringList currentClientOptions;
@@ -27,6 +32,9 @@ public:
     QString loadError;  // Non-empty if settings.json failed to load
 
     void setJavaInstallLocation(QString location);
+    void setDownloadRateLimit(int kilobytesPerSecond);
+    void setInstallSelection(InstallFilter::Profile profile, const QStringList &includes, const QStringList &excludes);
+    InstallFilter installFilter() const;
 
     // Build management
     QString getCurrentBuildUrl() const;
@@ -19,6 +19,12 @@ SettingsDialog::SettingsDialog(Settings *settings, QWidget *parent) :
         }
     }
 
+    ui->rateLimitSpinBox->setValue(settings->downloadRateLimit);
+    // Combo box rows follow InstallFilter::Profile
+    ui->installProfileComboBox->setCurrentIndex(settings->installProfile);
+    ui->installIncludeEdit->setText(settings->installIncludes.join(' '));
+    ui->installExcludeEdit->setText(settings->installExcludes.join(' '));
+
     this->settings = settings;
     connect(this, &QDialog::finished, this, &QObject::deleteLater);
 }
@@ -35,5 +41,9 @@ void SettingsDialog::accept()
     {
         settings->setCurrentBuild(selectedItem->data(Qt::UserRole).toString());
     }
+    settings->setDownloadRateLimit(ui->rateLimitSpinBox->value());
+    settings->setInstallSelection(static_cast<InstallFilter::Profile>(ui->installProfileComboBox->currentIndex()),
+                                  ui->installIncludeEdit->text().split(' ', Qt::SkipEmptyParts),
+                                  ui->installExcludeEdit->text().split(' ', Qt::SkipEmptyParts));
     QDialog::accept();
 }
@@ -0,0 +1,307 @@
+#include "streamdecoder.h"
+#include <QThread>
+#include <cstring>
+#include <lzma.h>
+#include <zlib.h>
+#include <zstd.h>
+
+namespace
+{
+
+class PlainDecoder : public StreamDecoder
+{
+public:
+    void setInput(const char *data, qint64 size) override
+    {
+        input = data;
+        available = size;
+    }
+
+    qint64 decode(char *out, qint64 size) override
+    {
+        qint64 take = qMin(size, available);
+        if (take > 0)
+        {
+            memcpy(out, input, take);
+            input += take;
+            available -= take;
+        }
+        return take;
+    }
+
+    bool atEnd() const override
+    {
+        return true;
+    }
+
+private:
+    const char *input = nullptr;
+    qint64 available = 0;
+};
+
+class GzipDecoder : public StreamDecoder
+{
+public:
+    GzipDecoder()
+    {
+        memset(&stream, 0, sizeof(stream));
+        // 15 + 32: maximum window, detect the gzip header automatically
+        active = inflateInit2(&stream, 15 + 32) == Z_OK;
+    }
+
+    ~GzipDecoder()
+    {
+        if (active)
+        {
+            inflateEnd(&stream);
+        }
+    }
+
+    void setInput(const char *data, qint64 size) override
+    {
+        stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+        stream.avail_in = static_cast<uInt>(size);
+    }
+
+    qint64 decode(char *out, qint64 size) override
+    {
+        if (!active)
+        {
+            error = "Error initializing gzip decoder";
+            return -1;
+        }
+        stream.next_out = reinterpret_cast<Bytef *>(out);
+        stream.avail_out = static_cast<uInt>(size);
+        while (stream.avail_out > 0)
+        {
+            if (ended)
+            {
+                if (stream.avail_in == 0)
+                {
+                    break;
+                }
+                // Another gzip member follows
+                inflateReset(&stream);
+                ended = false;
+            }
+            int ret = inflate(&stream, Z_NO_FLUSH);
+            if (ret == Z_STREAM_END)
+            {
+                ended = true;
+            }
+            else if (ret == Z_BUF_ERROR || (ret == Z_OK && stream.avail_in == 0))
+            {
+                break;
+            }
+            else if (ret != Z_OK)
+            {
+                error = "Error decompressing gzip data";
+                return -1;
+            }
+        }
+        return size - stream.avail_out;
+    }
+
+    bool atEnd() const override
+    {
+        return ended;
+    }
+
+private:
+    z_stream stream;
+    bool active = false;
+    bool ended = false;
+};
+
+class XzDecoder : public StreamDecoder
+{
+public:
+    XzDecoder()
+    {
+        lzma_ret ret;
+#if LZMA_VERSION >= 50040002
+        // Archives written with xz -T split into blocks that decode in
+        // parallel; single-block streams just use one thread
+        lzma_mt options;
+        memset(&options, 0, sizeof(options));
+        options.threads = static_cast<uint32_t>(qMax(1, QThread::idealThreadCount()));
+        options.memlimit_threading = STREAM_DECODER_XZ_MEMLIMIT;
+        options.memlimit_stop = UINT64_MAX;
+        ret = lzma_stream_decoder_mt(&stream, &options);
+#else
+        ret = lzma_stream_decoder(&stream, UINT64_MAX, 0);
+#endif
+        active = ret == LZMA_OK;
+    }
+
+    ~XzDecoder()
+    {
+        lzma_end(&stream);
+    }
+
+    void setInput(const char *data, qint64 size) override
+    {
+        stream.next_in = reinterpret_cast<const uint8_t *>(data);
+        stream.avail_in = static_cast<size_t>(size);
+    }
+
+    qint64 decode(char *out, qint64 size) override
+    {
+        if (!active)
+        {
+            error = "Error initializing xz decoder";
+            return -1;
+        }
+        stream.next_out = reinterpret_cast<uint8_t *>(out);
+        stream.avail_out = static_cast<size_t>(size);
+        while (stream.avail_out > 0 && !ended)
+        {
+            // LZMA_FINISH lets the threaded decoder flush what its workers
+            // still hold once no more input is coming
+            lzma_ret ret = lzma_code(&stream, inputEnded ? LZMA_FINISH : LZMA_RUN);
+            if (ret == LZMA_STREAM_END)
+            {
+                ended = true;
+            }
+            else if (ret == LZMA_BUF_ERROR || (ret == LZMA_OK && stream.avail_in == 0 && !inputEnded))
+            {
+                break;
+            }
+            else if (ret != LZMA_OK)
+            {
+                error = "Error decompressing xz data";
+                return -1;
+            }
+        }
+        return size - static_cast<qint64>(stream.avail_out);
+    }
+
+    bool atEnd() const override
+    {
+        return ended;
+    }
+
+private:
+    lzma_stream stream = LZMA_STREAM_INIT;
+    bool active = false;
+    bool ended = false;
+};
+
+class ZstdDecoder : public StreamDecoder
+{
+public:
+    ZstdDecoder()
+    {
+        context = ZSTD_createDCtx();
+    }
+
+    ~ZstdDecoder()
+    {
+        ZSTD_freeDCtx(context);
+    }
+
+    void setInput(const char *data, qint64 size) override
+    {
+        input.src = data;
+        input.size = static_cast<size_t>(size);
+        input.pos = 0;
+    }
+
+    qint64 decode(char *out, qint64 size) override
+    {
+        if (context == nullptr)
+        {
+            error = "Error initializing zstd decoder";
+            return -1;
+        }
+        ZSTD_outBuffer output = { out, static_cast<size_t>(size), 0 };
+        while (output.pos < output.size)
+        {
+            size_t ret = ZSTD_decompressStream(context, &output, &input);
+            if (ZSTD_isError(ret))
+            {
+                error = QString("Error decompressing zstd data: ") + ZSTD_getErrorName(ret);
+                return -1;
+            }
+            // 0 means a frame was completely decoded and flushed; the next
+            // frame, if any, starts on the following call
+            ended = ret == 0;
+            if (input.pos == input.size && output.pos < output.size)
+            {
+                break;
+            }
+        }
+        return static_cast<qint64>(output.pos);
+    }
+
+    bool atEnd() const override
+    {
+        return ended;
+    }
+
+private:
+    ZSTD_DCtx *context;
+    ZSTD_inBuffer input = { nullptr, 0, 0 };
+    bool ended = false;
+};
+
+}
+
+void StreamDecoder::endInput()
+{
+    inputEnded = true;
+}
+
+QString StreamDecoder::errorString() const
+{
+    return error;
+}
+
+StreamDecoder::Format StreamDecoder::sniff(const QByteArray &head)
+{
+    const uchar *p = reinterpret_cast<const uchar *>(head.constData());
+    if (head.size() >= 2 && p[0] == 0x1f && p[1] == 0x8b)
+    {
+        return Gzip;
+    }
+    if (head.size() >= 6 && memcmp(p, "\xfd" "7zXZ\0", 6) == 0)
+    {
+        return Xz;
+    }
+    if (head.size() >= 4 && p[0] == 0x28 && p[1] == 0xb5 && p[2] == 0x2f && p[3] == 0xfd)
+    {
+        return Zstd;
+    }
+    // Anything else is handed on as is; the tar checksums catch garbage
+    return Plain;
+}
+
+StreamDecoder *StreamDecoder::create(Format format)
+{
+    switch (format)
+    {
+    case Gzip:
+        return new GzipDecoder();
+    case Xz:
+        return new XzDecoder();
+    case Zstd:
+        return new ZstdDecoder();
+    default:
+        return new PlainDecoder();
+    }
+}
+
+QString StreamDecoder::formatName(Format format)
+{
+    switch (format)
+    {
+    case Gzip:
+        return "gzip";
+    case Xz:
+        return "xz";
+    case Zstd:
+        return "zstd";
+    default:
+        return "uncompressed";
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef STREAMDECODER_H
+#define STREAMDECODER_H
+
+#include <QByteArray>
+#include <QString>
+
+// Bytes needed to tell the formats apart (the xz magic is the longest)
+#define STREAM_DECODER_SNIFF_SIZE 6
+// Memory the multi-threaded xz decoder may use before it falls back to
+// decoding on one thread
+#define STREAM_DECODER_XZ_MEMLIMIT (512ULL * 1024 * 1024)
+
+// Incremental decompressor for the outer layer of a streamed archive. The
+// format is picked from the first bytes of the data rather than the file
+// name, so a mirror may serve .tar.gz, .tar.xz or .tar.zst under any name.
+//
+// Usage: setInput() with each chunk, then decode() until it returns 0.
+// After the last chunk call endInput() and drain decode() once more.
+class StreamDecoder
+{
+public:
+    enum Format
+    {
+        Plain,
+        Gzip,
+        Xz,
+        Zstd
+    };
+
+    virtual ~StreamDecoder() {}
+    // The data must stay valid until decode() has used it up
+    virtual void setInput(const char *data, qint64 size) = 0;
+    // Decodes into out and returns the number of bytes written: 0 once the
+    // input is used up and nothing more is buffered, -1 on corrupt data
+    virtual qint64 decode(char *out, qint64 size) = 0;
+    // Whether the compressed stream ended where it should
+    virtual bool atEnd() const = 0;
+    void endInput();
+    QString errorString() const;
+
+    static Format sniff(const QByteArray &head);
+    static StreamDecoder *create(Format format);
+    static QString formatName(Format format);
+
+protected:
+    bool inputEnded = false;
+    QString error;
+};
+
+#endif // STREAMDECODER_H
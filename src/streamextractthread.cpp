@@ -0,0 +1,276 @@
+#include "streamextractthread.h"
+#include <QFile>
+#include <QFileInfo>
+#include "installswap.h"
+#include "unzipthread.h"
+
+StreamExtractThread::StreamExtractThread(QString destPath)
+{
+    this->destPath = destPath;
+    this->stagingPath = destPath + "/.stream-staging";
+}
+
+void StreamExtractThread::feed(QByteArray data)
+{
+    QMutexLocker locker(&mutex);
+    queuedBytes += data.size();
+    chunks.enqueue(data);
+    dataAvailable.wakeOne();
+}
+
+qint64 StreamExtractThread::space()
+{
+    QMutexLocker locker(&mutex);
+    qint64 room = qMax<qint64>(0, STREAM_EXTRACT_BUFFER_SIZE - queuedBytes);
+    if (room == 0)
+    {
+        full = true;
+    }
+    return room;
+}
+
+void StreamExtractThread::finish()
+{
+    QMutexLocker locker(&mutex);
+    inputFinished = true;
+    dataAvailable.wakeOne();
+}
+
+void StreamExtractThread::abort()
+{
+    QMutexLocker locker(&mutex);
+    aborted = true;
+    chunks.clear();
+    queuedBytes = 0;
+    dataAvailable.wakeOne();
+}
+
+void StreamExtractThread::setTotalSize(qint64 totalSize)
+{
+    QMutexLocker locker(&mutex);
+    this->totalSize = totalSize;
+}
+
+void StreamExtractThread::setSourceFile(const QString &fileName)
+{
+    sourceFile = fileName;
+}
+
+void StreamExtractThread::setFilter(const InstallFilter &filter)
+{
+    this->filter = filter;
+}
+
+void StreamExtractThread::run()
+{
+    QDir(stagingPath).removeRecursively();
+    if (!QDir().mkpath(stagingPath))
+    {
+        emit extract_fail("Error creating directory " + stagingPath);
+        return;
+    }
+
+    bool ok = true;
+    bool wasAborted = false;
+    if (!sourceFile.isEmpty())
+    {
+        ok = consumeSourceFile(&wasAborted);
+    }
+    else
+    {
+        qint64 consumed = 0;
+        qint64 lastReported = 0;
+        while (ok)
+        {
+            QByteArray chunk;
+            qint64 total;
+            bool wake = false;
+            {
+                QMutexLocker locker(&mutex);
+                while (chunks.isEmpty() && !inputFinished && !aborted)
+                {
+                    dataAvailable.wait(&mutex);
+                }
+                if (aborted)
+                {
+                    wasAborted = true;
+                    break;
+                }
+                if (chunks.isEmpty())
+                {
+                    break; // Input finished and fully consumed
+                }
+                chunk = chunks.dequeue();
+                total = totalSize;
+                queuedBytes -= chunk.size();
+                if (full && queuedBytes <= STREAM_EXTRACT_BUFFER_SIZE / 2)
+                {
+                    full = false;
+                    wake = true;
+                }
+            }
+            if (wake)
+            {
+                emit space_available();
+            }
+            ok = consume(chunk.constData(), chunk.size());
+
+            // Progress counts archive bytes actually extracted, not just received
+            consumed += chunk.size();
+            if (consumed - lastReported >= STREAM_PROGRESS_STEP || consumed == total)
+            {
+                emit progress(consumed, total);
+                lastReported = consumed;
+            }
+        }
+    }
+
+    if (ok && !wasAborted)
+    {
+        ok = complete();
+    }
+    QDir(stagingPath).removeRecursively();
+
+    if (wasAborted)
+    {
+        emit extract_fail("Extraction cancelled");
+    }
+    else if (!ok)
+    {
+        emit extract_fail(errorMessage);
+    }
+    else
+    {
+        emit log("Extraction complete");
+        emit extract_complete(destPath);
+    }
+}
+
+bool StreamExtractThread::consumeSourceFile(bool *wasAborted)
+{
+    QFile file(sourceFile);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        errorMessage = "Error opening " + sourceFile;
+        return false;
+    }
+    qint64 total = file.size();
+    qint64 consumed = 0;
+    qint64 lastReported = 0;
+    QByteArray chunk(STREAM_FILE_CHUNK_SIZE, Qt::Uninitialized);
+    while (consumed < total)
+    {
+        {
+            QMutexLocker locker(&mutex);
+            if (aborted)
+            {
+                *wasAborted = true;
+                return true;
+            }
+        }
+        qint64 read = file.read(chunk.data(), chunk.size());
+        if (read <= 0)
+        {
+            errorMessage = "Error reading " + sourceFile;
+            return false;
+        }
+        if (!consume(chunk.constData(), read))
+        {
+            return false;
+        }
+        consumed += read;
+        if (consumed - lastReported >= STREAM_PROGRESS_STEP || consumed == total)
+        {
+            emit progress(consumed, total);
+            lastReported = consumed;
+        }
+    }
+    return true;
+}
+
+bool StreamExtractThread::safeEntryPath(const QString &name, QString *path)
+{
+    QString cleaned = QDir::cleanPath(name);
+    if (cleaned.isEmpty() || cleaned == "." || cleaned.startsWith('/') || cleaned == ".." ||
+        cleaned.startsWith("../") || cleaned.contains(':'))
+    {
+        errorMessage = "Unsafe path in archive: " + name;
+        return false;
+    }
+    *path = cleaned;
+    return true;
+}
+
+bool StreamExtractThread::wanted(const QString &path, bool stripRoot)
+{
+    if (filter.isEmpty())
+    {
+        return true;
+    }
+    QString name = path;
+    if (stripRoot)
+    {
+        // Whether the archive has a root folder is only known at the end;
+        // until then the first entry's top folder is taken for it
+        QString top = path.section('/', 0, 0);
+        if (filterRoot.isEmpty())
+        {
+            filterRoot = top;
+        }
+        filterRootShared = filterRootShared && top == filterRoot;
+        name = path.section('/', 1);
+        if (name.isEmpty())
+        {
+            return true;
+        }
+    }
+    if (filter.accepts(name))
+    {
+        return true;
+    }
+    filteredEntries++;
+    return false;
+}
+
+bool StreamExtractThread::installStaged(bool stripRoot, const QStringList &cleanDirs)
+{
+    QString sourcePath = stagingPath;
+    QStringList topLevel = QDir(stagingPath).entryList(QDir::AllEntries | QDir::Hidden | QDir::NoDotAndDotDot);
+    if (stripRoot && topLevel.size() == 1 && QFileInfo(stagingPath + '/' + topLevel.first()).isDir())
+    {
+        sourcePath = stagingPath + '/' + topLevel.first();
+        strippedRoot = topLevel.first();
+        emit log("Stripping root folder: " + topLevel.first() + '/');
+    }
+
+    if (filteredEntries > 0)
+    {
+        if (stripRoot && !filterRootShared)
+        {
+            errorMessage = "Archive has no single root folder to apply the install profile to";
+            return false;
+        }
+        emit log(QString("Skipped %1 entries outside the install profile").arg(filteredEntries));
+    }
+
+    // Owned directories are swapped in whole and the old copies deleted in
+    // the background; a failed rename puts everything back
+    emit log("Extracting to: " + destPath);
+    InstallSwap swap(UnzipThread::trashPath(destPath));
+    bool swapped = true;
+    for (const QString &dir : filter.keptDirs(cleanDirs))
+    {
+        if (!swap.replaceDirectory(sourcePath + '/' + dir, destPath + '/' + dir))
+        {
+            swapped = false;
+            break;
+        }
+    }
+    if (!swapped || !swap.moveTree(sourcePath, destPath))
+    {
+        swap.rollback();
+        errorMessage = swap.errorMessage() + ", installed files were left unchanged";
+        return false;
+    }
+    return true;
+}
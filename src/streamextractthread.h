@@ -0,0 +1,96 @@
+#ifndef STREAMEXTRACTTHREAD_H
+#define STREAMEXTRACTTHREAD_H
+
+#include <QByteArray>
+#include <QDir>
+#include <QMutex>
+#include <QQueue>
+#include <QString>
+#include <QStringList>
+#include <QThread>
+#include <QWaitCondition>
+#include "installfilter.h"
+
+#define STREAM_PROGRESS_STEP (1024 * 1024)
+#define STREAM_FILE_CHUNK_SIZE (1024 * 1024)
+#define STREAM_EXTRACT_BUFFER_SIZE (8 * 1024 * 1024)
+
+// Base class for extractors that decode an archive while it is still being
+// downloaded. The network side calls feed() with each chunk as it arrives
+// and finish() once the transfer is complete; run() hands the chunks to
+// consume() in order on the extraction thread. Like DiskWriterThread, no
+// more than STREAM_EXTRACT_BUFFER_SIZE bytes are queued: the feeder checks
+// space() and otherwise waits for space_available(). feed(), space(),
+// finish() and abort() may be called from any thread.
+//
+// setSourceFile() reads an archive that is already on disk through the same
+// path instead, for when it could not be streamed.
+//
+// With setFilter() subclasses skip writing the entries the install profile
+// leaves out; their bytes still pass through to keep the stream in step.
+class StreamExtractThread : public QThread
+{
+    Q_OBJECT
+public:
+    StreamExtractThread(QString destPath);
+    void run() override;
+
+    void feed(QByteArray data);
+    qint64 space();
+    void finish();
+    void abort();
+    void setTotalSize(qint64 totalSize);
+    void setSourceFile(const QString &fileName);
+    void setFilter(const InstallFilter &filter);
+
+protected:
+    QString destPath;
+    QString stagingPath;
+
+    // Called on the extraction thread for every chunk in download order.
+    // Return false (after setting errorMessage) to stop extracting.
+    virtual bool consume(const char *data, qint64 size) = 0;
+    // Called once all input has been consumed.
+    virtual bool complete() = 0;
+    // Moves the extracted tree into destPath with an InstallSwap, skipping a
+    // single root folder when stripRoot is set and replacing cleanDirs whole.
+    // The replaced files go to UnzipThread::trashPath(destPath).
+    bool installStaged(bool stripRoot, const QStringList &cleanDirs);
+    // Top folder installStaged() skipped, if any
+    QString strippedRoot;
+    // Cleans an archive entry name into a relative path, refusing names
+    // that would escape the extraction directory.
+    bool safeEntryPath(const QString &name, QString *path);
+    // Whether the filter selects a cleaned entry path. With stripRoot the
+    // path is judged without its top folder, which must then turn out to be
+    // shared by every entry for installStaged() to accept the result.
+    bool wanted(const QString &path, bool stripRoot);
+
+    QString errorMessage;
+
+private:
+    QMutex mutex;
+    QWaitCondition dataAvailable;
+    QQueue<QByteArray> chunks;
+    qint64 queuedBytes = 0;
+    bool full = false;
+    bool inputFinished = false;
+    bool aborted = false;
+    qint64 totalSize = -1;
+    QString sourceFile;
+    InstallFilter filter;
+    QString filterRoot;
+    bool filterRootShared = true;
+    int filteredEntries = 0;
+
+    bool consumeSourceFile(bool *wasAborted);
+
+signals:
+    void log(QString message);
+    void space_available();
+    void progress(qint64 complete, qint64 total);
+    void extract_complete(QString installLocation);
+    void extract_fail(QString errorMessage);
+};
+
+#endif // STREAMEXTRACTTHREAD_H
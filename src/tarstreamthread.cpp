@@ -0,0 +1,549 @@
+#include "tarstreamthread.h"
+#include <QFileInfo>
+#include <cstring>
+
+TarStreamThread::TarStreamThread(QString destPath, bool stripRoot, QStringList cleanDirs)
+    : StreamExtractThread(destPath)
+{
+    this->stripRoot = stripRoot;
+    this->cleanDirs = cleanDirs;
+    decoded.resize(TAR_BUFFER_SIZE);
+}
+
+TarStreamThread::~TarStreamThread()
+{
+    delete decoder;
+    if (out.isOpen())
+    {
+        out.close();
+    }
+}
+
+bool TarStreamThread::isTarArchive(const QString &fileName)
+{
+    static const QStringList suffixes = { ".tar", ".tar.gz", ".tgz", ".tar.xz", ".txz", ".tar.zst", ".tzst" };
+    for (const QString &suffix : suffixes)
+    {
+        if (fileName.endsWith(suffix, Qt::CaseInsensitive))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool TarStreamThread::consume(const char *data, qint64 size)
+{
+    if (decoder != nullptr)
+    {
+        return decodeInput(data, size);
+    }
+
+    // The first bytes decide the decoder
+    head.append(data, size);
+    if (head.size() < STREAM_DECODER_SNIFF_SIZE)
+    {
+        return true;
+    }
+    startDecoder();
+    QByteArray input = head;
+    head.clear();
+    return decodeInput(input.constData(), input.size());
+}
+
+void TarStreamThread::startDecoder()
+{
+    StreamDecoder::Format format = StreamDecoder::sniff(head);
+    decoder = StreamDecoder::create(format);
+    emit log("Archive compression: " + StreamDecoder::formatName(format));
+}
+
+bool TarStreamThread::decodeInput(const char *data, qint64 size)
+{
+    decoder->setInput(data, size);
+    while (true)
+    {
+        // Anything after the end of both the tar and the compressed stream
+        // is padding
+        if (state == End && decoder->atEnd())
+        {
+            return true;
+        }
+        qint64 length = decoder->decode(decoded.data(), decoded.size());
+        if (length < 0)
+        {
+            errorMessage = decoder->errorString();
+            return false;
+        }
+        if (length == 0)
+        {
+            return true;
+        }
+        if (!consumeTar(decoded.constData(), length))
+        {
+            return false;
+        }
+    }
+}
+
+bool TarStreamThread::consumeTar(const char *data, qint64 size)
+{
+    qint64 pos = 0;
+    while (pos < size && state != End)
+    {
+        if (state == Header)
+        {
+            qint64 take = qMin<qint64>(TAR_BLOCK_SIZE - header.size(), size - pos);
+            header.append(data + pos, take);
+            pos += take;
+            if (header.size() < TAR_BLOCK_SIZE)
+            {
+                break;
+            }
+            bool ok = parseHeader(reinterpret_cast<const uchar *>(header.constData()));
+            header.clear();
+            if (!ok)
+            {
+                return false;
+            }
+        }
+        else if (state == EntryData)
+        {
+            qint64 take = qMin(remaining, size - pos);
+            if (kind == RegularFile)
+            {
+                if (out.write(data + pos, take) != take)
+                {
+                    errorMessage = "Error writing to file " + entryPath;
+                    return false;
+                }
+            }
+            else if (kind == LongName || kind == LongLinkName || kind == PaxHeader)
+            {
+                metadata.append(data + pos, take);
+            }
+            pos += take;
+            remaining -= take;
+            if (remaining == 0)
+            {
+                if (!finishEntry())
+                {
+                    return false;
+                }
+                state = padding > 0 ? Padding : Header;
+            }
+        }
+        else if (state == Padding)
+        {
+            qint64 take = qMin(padding, size - pos);
+            pos += take;
+            padding -= take;
+            if (padding == 0)
+            {
+                state = Header;
+            }
+        }
+    }
+    return true;
+}
+
+bool TarStreamThread::parseHeader(const uchar *block)
+{
+    // Two zero blocks mark the end of the archive
+    bool zero = true;
+    for (int i = 0; i < TAR_BLOCK_SIZE; i++)
+    {
+        if (block[i] != 0)
+        {
+            zero = false;
+            break;
+        }
+    }
+    if (zero)
+    {
+        if (++zeroBlocks >= 2)
+        {
+            state = End;
+        }
+        return true;
+    }
+    zeroBlocks = 0;
+
+    qint64 checksum = 0;
+    for (int i = 0; i < TAR_BLOCK_SIZE; i++)
+    {
+        checksum += (i >= 148 && i < 156) ? ' ' : block[i];
+    }
+    if (checksum != parseNumber(block + 148, 8))
+    {
+        errorMessage = "Corrupt tar header after " + QString::number(entryCount) + " entries";
+        return false;
+    }
+
+    QString name = parseString(block, 100);
+    if (memcmp(block + 257, "ustar", 5) == 0)
+    {
+        QString prefix = parseString(block + 345, 155);
+        if (!prefix.isEmpty())
+        {
+            name = prefix + '/' + name;
+        }
+    }
+    qint64 size = parseNumber(block + 124, 12);
+    mode = static_cast<quint32>(parseNumber(block + 100, 8));
+    linkTarget = parseString(block + 157, 100);
+
+    switch (block[156])
+    {
+    case '0':
+    case '\0':
+    case '7':
+        kind = RegularFile;
+        break;
+    case '5':
+        kind = Directory;
+        break;
+    case '2':
+        kind = SymLink;
+        break;
+    case '1':
+        kind = HardLink;
+        break;
+    case 'L':
+        kind = LongName;
+        break;
+    case 'K':
+        kind = LongLinkName;
+        break;
+    case 'x':
+        kind = PaxHeader;
+        break;
+    default:
+        // Global pax headers, devices, fifos: skip their data
+        kind = Ignored;
+        break;
+    }
+
+    if (kind != LongName && kind != LongLinkName && kind != PaxHeader)
+    {
+        if (!nextPath.isEmpty())
+        {
+            name = nextPath;
+        }
+        if (!nextLinkTarget.isEmpty())
+        {
+            linkTarget = nextLinkTarget;
+        }
+        if (nextSize >= 0)
+        {
+            size = nextSize;
+        }
+        nextPath.clear();
+        nextLinkTarget.clear();
+        nextSize = -1;
+    }
+
+    entryPath = name;
+    remaining = (kind == Directory || kind == SymLink || kind == HardLink) ? 0 : size;
+    padding = (TAR_BLOCK_SIZE - remaining % TAR_BLOCK_SIZE) % TAR_BLOCK_SIZE;
+    metadata.clear();
+    if (!beginEntry())
+    {
+        return false;
+    }
+    if (remaining == 0)
+    {
+        if (!finishEntry())
+        {
+            return false;
+        }
+        state = Header;
+    }
+    else
+    {
+        state = EntryData;
+    }
+    return true;
+}
+
+bool TarStreamThread::beginEntry()
+{
+    if (kind == LongName || kind == LongLinkName || kind == PaxHeader || kind == Ignored)
+    {
+        return true;
+    }
+
+    QString path;
+    if (!safeEntryPath(entryPath, &path))
+    {
+        return false;
+    }
+    if (!wanted(path, stripRoot))
+    {
+        // The data is read past without being written
+        kind = Ignored;
+        return true;
+    }
+    if (!staysInStaging(path))
+    {
+        errorMessage = "Unsafe path in archive: " + entryPath + " goes through a symlink";
+        return false;
+    }
+    QString outPath = stagingPath + '/' + path;
+
+    if (kind == Directory)
+    {
+        QDir().mkpath(outPath);
+        return true;
+    }
+
+    // Ensure parent directory exists
+    QFileInfo(outPath).dir().mkpath(".");
+    QFile::remove(outPath);
+
+    if (kind == SymLink)
+    {
+        // Only relative links that stay inside the archive, so a later entry
+        // cannot be written through a link to somewhere else
+        if (linkTarget.startsWith('/') || !staysInStaging(QFileInfo(path).path() + '/' + linkTarget))
+        {
+            errorMessage = "Unsafe symlink in archive: " + entryPath + " -> " + linkTarget;
+            return false;
+        }
+        if (!QFile::link(linkTarget, outPath))
+        {
+            errorMessage = "Error creating symlink " + entryPath;
+            return false;
+        }
+        return true;
+    }
+    if (kind == HardLink)
+    {
+        QString targetPath;
+        if (!safeEntryPath(linkTarget, &targetPath))
+        {
+            return false;
+        }
+        if (!staysInStaging(targetPath))
+        {
+            errorMessage = "Unsafe link in archive: " + entryPath + " -> " + linkTarget;
+            return false;
+        }
+        if (!QFile::copy(stagingPath + '/' + targetPath, outPath))
+        {
+            errorMessage = "Error creating link " + entryPath;
+            return false;
+        }
+        return true;
+    }
+
+    out.setFileName(outPath);
+    if (!out.open(QIODevice::WriteOnly))
+    {
+        errorMessage = "Error creating file " + entryPath;
+        return false;
+    }
+    return true;
+}
+
+bool TarStreamThread::staysInStaging(const QString &path) const
+{
+    // Walked one component at a time against what is already extracted:
+    // with a -> "." on disk, "a/.." is the staging directory's parent even
+    // though cleanPath() makes it ".". Links the archive created may only be
+    // the last component.
+    QStringList resolved;
+    const QStringList parts = path.split('/', Qt::SkipEmptyParts);
+    for (int i = 0; i < parts.size(); i++)
+    {
+        if (parts[i] == ".")
+        {
+            continue;
+        }
+        if (parts[i] == "..")
+        {
+            if (resolved.isEmpty())
+            {
+                return false;
+            }
+            resolved.removeLast();
+            continue;
+        }
+        resolved.append(parts[i]);
+        if (i < parts.size() - 1 && QFileInfo(stagingPath + '/' + resolved.join('/')).isSymLink())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TarStreamThread::finishEntry()
+{
+    switch (kind)
+    {
+    case RegularFile:
+        out.close();
+        if (out.error() != QFileDevice::NoError)
+        {
+            errorMessage = "Error writing to file " + entryPath;
+            return false;
+        }
+        // The JRE is useless without its executable bits
+        out.setPermissions(permissions(mode));
+        entryCount++;
+        break;
+    case LongName:
+        nextPath = parseString(reinterpret_cast<const uchar *>(metadata.constData()), metadata.size());
+        break;
+    case LongLinkName:
+        nextLinkTarget = parseString(reinterpret_cast<const uchar *>(metadata.constData()), metadata.size());
+        break;
+    case PaxHeader:
+        parsePax(metadata);
+        break;
+    default:
+        entryCount++;
+        break;
+    }
+    return true;
+}
+
+void TarStreamThread::parsePax(const QByteArray &records)
+{
+    // Records are "<length> <key>=<value>\n", length including itself
+    int pos = 0;
+    while (pos < records.size())
+    {
+        int space = records.indexOf(' ', pos);
+        if (space < 0)
+        {
+            break;
+        }
+        bool ok = false;
+        int length = records.mid(pos, space - pos).toInt(&ok);
+        if (!ok || length <= space - pos + 1 || pos + length > records.size())
+        {
+            break;
+        }
+        QByteArray keyValue = records.mid(space + 1, pos + length - space - 2);
+        int equals = keyValue.indexOf('=');
+        if (equals > 0)
+        {
+            QByteArray key = keyValue.left(equals);
+            QByteArray value = keyValue.mid(equals + 1);
+            if (key == "path")
+            {
+                nextPath = QString::fromUtf8(value);
+            }
+            else if (key == "linkpath")
+            {
+                nextLinkTarget = QString::fromUtf8(value);
+            }
+            else if (key == "size")
+            {
+                nextSize = value.toLongLong();
+            }
+        }
+        pos += length;
+    }
+}
+
+bool TarStreamThread::complete()
+{
+    // Archives shorter than the sniffed prefix, and whatever the decoder
+    // still holds back, come out now
+    if (decoder == nullptr)
+    {
+        startDecoder();
+    }
+    decoder->endInput();
+    QByteArray input = head;
+    head.clear();
+    if (!decodeInput(input.constData(), input.size()))
+    {
+        return false;
+    }
+
+    if (!decoder->atEnd() || (state != End && state != Header))
+    {
+        errorMessage = "Archive ended unexpectedly";
+        return false;
+    }
+    emit log(QString("Extracted %1 entries").arg(entryCount));
+    return installStaged(stripRoot, cleanDirs);
+}
+
+qint64 TarStreamThread::parseNumber(const uchar *field, int length)
+{
+    qint64 value = 0;
+    if (field[0] & 0x80)
+    {
+        // GNU base-256 encoding for sizes over 8 GB
+        value = field[0] & 0x7f;
+        for (int i = 1; i < length; i++)
+        {
+            value = (value << 8) | field[i];
+        }
+        return value;
+    }
+    int i = 0;
+    while (i < length && (field[i] == ' ' || field[i] == '\0'))
+    {
+        i++;
+    }
+    while (i < length && field[i] >= '0' && field[i] <= '7')
+    {
+        value = (value << 3) | (field[i] - '0');
+        i++;
+    }
+    return value;
+}
+
+QString TarStreamThread::parseString(const uchar *field, int length)
+{
+    const char *text = reinterpret_cast<const char *>(field);
+    return QString::fromUtf8(text, static_cast<int>(qstrnlen(text, length)));
+}
+
+QFile::Permissions TarStreamThread::permissions(quint32 mode)
+{
+    QFile::Permissions result;
+    if (mode & 0400)
+    {
+        result |= QFile::ReadOwner | QFile::ReadUser;
+    }
+    if (mode & 0200)
+    {
+        result |= QFile::WriteOwner | QFile::WriteUser;
+    }
+    if (mode & 0100)
+    {
+        result |= QFile::ExeOwner | QFile::ExeUser;
+    }
+    if (mode & 0040)
+    {
+        result |= QFile::ReadGroup;
+    }
+    if (mode & 0020)
+    {
+        result |= QFile::WriteGroup;
+    }
+    if (mode & 0010)
+    {
+        result |= QFile::ExeGroup;
+    }
+    if (mode & 0004)
+    {
+        result |= QFile::ReadOther;
+    }
+    if (mode & 0002)
+    {
+        result |= QFile::WriteOther;
+    }
+    if (mode & 0001)
+    {
+        result |= QFile::ExeOther;
+    }
+    return result;
+}
@@ -0,0 +1,92 @@
+#ifndef TARSTREAMTHREAD_H
+#define TARSTREAMTHREAD_H
+
+#include <QFile>
+#include <QHash>
+#include <QStringList>
+#include "streamdecoder.h"
+#include "streamextractthread.h"
+
+#define TAR_BLOCK_SIZE 512
+#define TAR_BUFFER_SIZE (256 * 1024)
+
+// Extracts a tar stream as it downloads: the compression (gzip, xz, zstd or
+// none) is recognised from the first bytes and decoded by a StreamDecoder,
+// and the tar records are written out directly, including permissions and
+// symlinks. Understands ustar, GNU long names and pax path/size records,
+// which covers the JRE and XMage archives we ship.
+class TarStreamThread : public StreamExtractThread
+{
+    Q_OBJECT
+public:
+    TarStreamThread(QString destPath, bool stripRoot = false, QStringList cleanDirs = QStringList());
+    ~TarStreamThread();
+    // Whether a download name looks like a (possibly compressed) tarball
+    static bool isTarArchive(const QString &fileName);
+
+protected:
+    bool consume(const char *data, qint64 size) override;
+    bool complete() override;
+
+private:
+    enum State
+    {
+        Header,
+        EntryData,
+        Padding,
+        End
+    };
+
+    enum EntryKind
+    {
+        RegularFile,
+        Directory,
+        SymLink,
+        HardLink,
+        LongName,
+        LongLinkName,
+        PaxHeader,
+        Ignored
+    };
+
+    bool stripRoot;
+    QStringList cleanDirs;
+    StreamDecoder *decoder = nullptr;
+    QByteArray head; // Input held back until the format is known
+    QByteArray decoded;
+
+    State state = Header;
+    QByteArray header;
+    int zeroBlocks = 0;
+
+    // Current entry
+    EntryKind kind = Ignored;
+    QString entryPath;
+    QString linkTarget;
+    quint32 mode = 0;
+    qint64 remaining = 0;
+    qint64 padding = 0;
+    QFile out;
+    QByteArray metadata; // Payload of GNU long name and pax records
+
+    // Overrides for the next entry from GNU/pax extension records
+    QString nextPath;
+    QString nextLinkTarget;
+    qint64 nextSize = -1;
+
+    qint64 entryCount = 0;
+
+    void startDecoder();
+    bool decodeInput(const char *data, qint64 size);
+    bool consumeTar(const char *data, qint64 size);
+    bool parseHeader(const uchar *block);
+    bool beginEntry();
+    bool staysInStaging(const QString &path) const;
+    bool finishEntry();
+    void parsePax(const QByteArray &records);
+    static qint64 parseNumber(const uchar *field, int length);
+    static QString parseString(const uchar *field, int length);
+    static QFile::Permissions permissions(quint32 mode);
+};
+
+#endif // TARSTREAMTHREAD_H
@@ -0,0 +1,149 @@
+#include "taskgraph.h"
+#include <QTimer>
+
+TaskGraph::TaskGraph(QObject *parent)
+    : QObject(parent)
+{
+}
+
+void TaskGraph::addTask(const QString &name, const QStringList &dependencies, std::function<void()> run, bool required)
+{
+    tasks.append(Task{name, dependencies, run, required, Pending});
+}
+
+void TaskGraph::start()
+{
+    started = true;
+    schedule();
+    checkProgress();
+}
+
+int TaskGraph::indexOf(const QString &name) const
+{
+    for (int i = 0; i < tasks.size(); i++)
+    {
+        if (tasks[i].name == name)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool TaskGraph::isRunning(const QString &name) const
+{
+    int index = indexOf(name);
+    return index >= 0 && tasks[index].state == Running;
+}
+
+void TaskGraph::complete(const QString &name)
+{
+    int index = indexOf(name);
+    if (index < 0 || tasks[index].state != Running)
+    {
+        return;
+    }
+    tasks[index].state = Done;
+    schedule();
+    checkProgress();
+}
+
+void TaskGraph::fail(const QString &name, const QString &errorMessage)
+{
+    int index = indexOf(name);
+    if (index < 0 || tasks[index].state != Running)
+    {
+        return;
+    }
+    tasks[index].state = Failed;
+    if (tasks[index].required && !aborted)
+    {
+        aborted = true;
+        emit failed(name, errorMessage);
+    }
+    schedule();
+    checkProgress();
+}
+
+void TaskGraph::schedule()
+{
+    if (!started || aborted)
+    {
+        return;
+    }
+
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (Task &task : tasks)
+        {
+            if (task.state != Pending)
+            {
+                continue;
+            }
+            bool runnable = true;
+            bool skipped = false;
+            for (const QString &dependency : task.dependencies)
+            {
+                int index = indexOf(dependency);
+                State state = index >= 0 ? tasks[index].state : Done;
+                if (state == Failed)
+                {
+                    skipped = true;
+                }
+                else if (state != Done)
+                {
+                    runnable = false;
+                }
+            }
+            if (skipped)
+            {
+                // Only reachable through optional tasks: a failed required
+                // task aborts the whole graph
+                task.state = Failed;
+                changed = true;
+            }
+            else if (runnable)
+            {
+                task.state = Running;
+                // Started from the event loop so a task that finishes
+                // synchronously does not re-enter this loop
+                QTimer::singleShot(0, this, task.run);
+            }
+        }
+    }
+}
+
+void TaskGraph::checkProgress()
+{
+    if (!started)
+    {
+        return;
+    }
+
+    bool requiredDone = true;
+    bool anyActive = false;
+    for (const Task &task : tasks)
+    {
+        if (task.required && task.state != Done)
+        {
+            requiredDone = false;
+        }
+        if (task.state == Running || (task.state == Pending && !aborted))
+        {
+            anyActive = true;
+        }
+    }
+
+    if (requiredDone && !readyEmitted)
+    {
+        readyEmitted = true;
+        emit ready();
+    }
+    if (!anyActive && !finishedEmitted)
+    {
+        finishedEmitted = true;
+        emit finished();
+    }
+}
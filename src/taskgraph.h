@@ -0,0 +1,63 @@
+#ifndef TASKGRAPH_H
+#define TASKGRAPH_H
+
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <functional>
+
+// A small dependency graph of asynchronous steps. Each task's run function
+// starts the work and the task reports back later with complete() or
+// fail(); a task starts as soon as all its dependencies have completed, so
+// independent tasks run side by side.
+//
+// ready() fires once every required task is done. Optional tasks keep
+// running after that and only hold back finished(); when one fails, the
+// tasks depending on it are skipped instead of failing the graph.
+class TaskGraph : public QObject
+{
+    Q_OBJECT
+public:
+    TaskGraph(QObject *parent = nullptr);
+    void addTask(const QString &name, const QStringList &dependencies, std::function<void()> run, bool required = true);
+    void start();
+    void complete(const QString &name);
+    void fail(const QString &name, const QString &errorMessage);
+    bool isRunning(const QString &name) const;
+
+signals:
+    void ready();
+    void failed(QString name, QString errorMessage);
+    void finished();
+
+private:
+    enum State
+    {
+        Pending,
+        Running,
+        Done,
+        Failed
+    };
+
+    struct Task
+    {
+        QString name;
+        QStringList dependencies;
+        std::function<void()> run;
+        bool required;
+        State state;
+    };
+
+    QList<Task> tasks;
+    bool started = false;
+    bool aborted = false;
+    bool readyEmitted = false;
+    bool finishedEmitted = false;
+
+    int indexOf(const QString &name) const;
+    void schedule();
+    void checkProgress();
+};
+
+#endif // TASKGRAPH_H
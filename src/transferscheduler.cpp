@@ -0,0 +1,111 @@
+#include "transferscheduler.h"
+
+TransferScheduler::TransferScheduler(QObject *parent)
+    : QObject(parent)
+    , refillTimer(new QTimer(this))
+{
+    refillTimer->setInterval(TRANSFER_REFILL_INTERVAL);
+    connect(refillTimer, &QTimer::timeout, this, &TransferScheduler::refill);
+}
+
+void TransferScheduler::setRateLimit(qint64 bytesPerSecond)
+{
+    limit = qMax<qint64>(0, bytesPerSecond);
+    tokens = 0;
+}
+
+qint64 TransferScheduler::rateLimit() const
+{
+    return limit;
+}
+
+int TransferScheduler::addTransfer(Priority priority)
+{
+    int id = nextId++;
+    transfers.insert(id, priority);
+    if (!refillTimer->isActive())
+    {
+        refillClock.start();
+        refillTimer->start();
+    }
+    return id;
+}
+
+void TransferScheduler::removeTransfer(int id)
+{
+    transfers.remove(id);
+    if (transfers.isEmpty())
+    {
+        refillTimer->stop();
+    }
+    else if (!hasInteractive())
+    {
+        // Background transfers held back by the one that just ended
+        emit tokens_available();
+    }
+}
+
+void TransferScheduler::setPriority(int id, Priority priority)
+{
+    if (transfers.contains(id))
+    {
+        transfers.insert(id, priority);
+    }
+}
+
+bool TransferScheduler::hasInteractive() const
+{
+    for (Priority priority : transfers)
+    {
+        if (priority == Interactive)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+qint64 TransferScheduler::acquire(int id, qint64 wanted)
+{
+    bool throttled = transfers.value(id, Interactive) == Background && hasInteractive();
+    qint64 granted = wanted;
+    // Both buckets are only charged for what is actually granted, so bytes
+    // the background clamp denies stay available to interactive transfers
+    if (throttled)
+    {
+        granted = qMin(granted, qMax<qint64>(0, backgroundTokens));
+    }
+    if (limit > 0)
+    {
+        granted = qMin(granted, qMax<qint64>(0, tokens));
+        tokens -= granted;
+    }
+    if (throttled)
+    {
+        backgroundTokens -= granted;
+    }
+    if (granted < wanted)
+    {
+        starved = true;
+    }
+    return granted;
+}
+
+void TransferScheduler::refill()
+{
+    qint64 elapsed = refillClock.restart();
+    // Cap the bucket at a quarter second of traffic so an idle period does
+    // not turn into a burst
+    if (limit > 0)
+    {
+        qint64 burst = qMax<qint64>(TRANSFER_MIN_BURST, limit / 4);
+        tokens = qMin(burst, tokens + limit * elapsed / 1000);
+    }
+    backgroundTokens = qMin<qint64>(TRANSFER_BACKGROUND_RATE / 4,
+                                    backgroundTokens + TRANSFER_BACKGROUND_RATE * elapsed / 1000);
+    if (starved)
+    {
+        starved = false;
+        emit tokens_available();
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef TRANSFERSCHEDULER_H
+#define TRANSFERSCHEDULER_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+#include <QTimer>
+
+#define TRANSFER_REFILL_INTERVAL 50
+#define TRANSFER_BACKGROUND_RATE (64 * 1024)
+#define TRANSFER_READ_BUFFER_SIZE (1024 * 1024)
+#define TRANSFER_MIN_BURST (16 * 1024)
+
+// Paces every download the launcher runs. Transfers ask for bytes with
+// acquire() before reading from their replies and leave the rest in the
+// (bounded) socket buffer, so TCP flow control slows the sender down.
+//
+// Tokens for the global rate limit refill every TRANSFER_REFILL_INTERVAL
+// ms. Background transfers are held to a trickle while any interactive
+// transfer is running, so a launch is not slowed by prefetching.
+class TransferScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    enum Priority
+    {
+        Background,
+        Interactive
+    };
+
+    TransferScheduler(QObject *parent = nullptr);
+    // Bytes per second across all transfers; 0 means unlimited
+    void setRateLimit(qint64 bytesPerSecond);
+    qint64 rateLimit() const;
+    int addTransfer(Priority priority);
+    void removeTransfer(int id);
+    void setPriority(int id, Priority priority);
+    // Returns how many of the wanted bytes may be read now. When it is less
+    // than wanted, tokens_available() fires once more can be read.
+    qint64 acquire(int id, qint64 wanted);
+
+signals:
+    void tokens_available();
+
+private:
+    QHash<int, Priority> transfers;
+    int nextId = 1;
+    qint64 limit = 0;
+    qint64 tokens = 0;
+    qint64 backgroundTokens = 0;
+    bool starved = false;
+    QTimer *refillTimer;
+    QElapsedTimer refillClock;
+
+    bool hasInteractive() const;
+
+private slots:
+    void refill();
+};
+
+#endif // TRANSFERSCHEDULER_H
@@ -1,58 +1,88 @@
 #include "unzipthread.h"
+#include <QDeadlineTimer>
+#include <QDirIterator>
+#include "inflater.h"
+#include <algorithm>
+#if defined(Q_OS_UNIX)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
-UnzipThread::UnzipThread(QString fileName, QString destPath, bool stripRoot)
+UnzipThread::UnzipThread(QString fileName, QString destPath, bool stripRoot, const QStringList &cleanDirs)
 {
     this->fileName = fileName;
     this->destPath = destPath;
     this->stripRoot = stripRoot;
+    this->cleanDirs = cleanDirs;
+}
+
+void UnzipThread::setIncremental(bool incremental)
+{
+    this->incremental = incremental;
+}
+
+void UnzipThread::setFilter(const InstallFilter &filter)
+{
+    this->filter = filter;
 }
 
 void UnzipThread::run()
 {
     int error = 0;
     zip_t *zip = zip_open(fileName.toLocal8Bit(), ZIP_RDONLY, &error);
-    if (error != 0)
+    if (zip == NULL)
     {
-        zip_discard(zip);
         emit unzip_fail("Unzip: Error opening zip file");
         return;
     }
-    char buf[UNZIP_BUFFER_SIZE];
 
-    // Clean up old files before extracting
-    emit log("Removing old XMage files...");
-    QDir(destPath + "/mage-client/lib").removeRecursively();
-    QDir(destPath + "/mage-client/db").removeRecursively();
-    QDir(destPath + "/mage-server/lib").removeRecursively();
-    QDir(destPath + "/mage-server/db").removeRecursively();
+    // Everything goes into a staging directory next to the installed files
+    // first, so a failed extraction leaves the old ones untouched
+    QString stagingPath = destPath + "/" UNZIP_STAGING_DIR;
+    QDir(stagingPath).removeRecursively();
+    QDir().mkpath(stagingPath);
 
     emit log("Unzipping file " + fileName);
-    zip_int64_t numEntries = zip_get_num_entries(zip, 0);
 
-    // Determine if zip has a root folder we need to skip
-    // Check all entries to find common root directory prefix
-    QString rootFolder;
-    if (stripRoot && numEntries > 0)
+    // Index the archive once; the workers only look entries up by number
+    QList<Entry> entries;
+    if (!mapArchive(&entries))
     {
-        QString commonPrefix;
-        bool hasCommonRoot = true;
-
-        for (zip_int64_t i = 0; i < numEntries && hasCommonRoot; i++)
+        zip_int64_t numEntries = zip_get_num_entries(zip, 0);
+        for (zip_int64_t i = 0; i < numEntries; i++)
         {
             zip_stat_t stat;
             if (zip_stat_index(zip, i, 0, &stat) != 0)
             {
+                emit log("Unzip: Error getting info on file at index " + QString::number(i));
                 continue;
             }
-            QString entryName(stat.name);
-            int slashPos = entryName.indexOf('/');
+            ZipEntry info = ZipEntry();
+            info.method = stat.comp_method;
+            info.flags = stat.encryption_method != ZIP_EM_NONE ? 0x0001 : 0;
+            entries.append(Entry{static_cast<zip_uint64_t>(i), QString(stat.name), static_cast<qint64>(stat.size),
+                                 static_cast<qint64>(stat.comp_size), static_cast<quint32>(stat.crc), info,
+                                 QString()});
+        }
+    }
+    zip_discard(zip);
+
+    // Determine if zip has a root folder we need to skip
+    QString rootFolder;
+    if (stripRoot && !entries.isEmpty())
+    {
+        QString commonPrefix;
+        bool hasCommonRoot = true;
+        for (const Entry &entry : std::as_const(entries))
+        {
+            int slashPos = entry.path.indexOf('/');
             if (slashPos <= 0)
             {
                 // Entry at root level or invalid - no common root
                 hasCommonRoot = false;
                 break;
             }
-            QString prefix = entryName.left(slashPos + 1);
+            QString prefix = entry.path.left(slashPos + 1);
             if (commonPrefix.isEmpty())
             {
                 commonPrefix = prefix;
@@ -60,9 +90,9 @@ void UnzipThread::run()
             else if (prefix != commonPrefix)
             {
                 hasCommonRoot = false;
+                break;
             }
         }
-
         if (hasCommonRoot && !commonPrefix.isEmpty())
         {
             rootFolder = commonPrefix;
@@ -70,77 +100,654 @@ void UnzipThread::run()
         }
     }
     emit log("Extracting to: " + destPath);
+    cleanDirs = filter.keptDirs(cleanDirs);
 
-    for (zip_int64_t i = 0; i < numEntries; i++)
+    InstallIndex index(destPath);
+    bool useIndex = incremental && index.load();
+
+    // Directories are created up front so workers never race on mkpath
+    QList<Entry> files;
+    QList<Entry> installed;
+    QSet<QString> archiveFiles;
+    QSet<QString> dirs;
+    qint64 totalBytes = 0;
+    int filtered = 0;
+    for (Entry &entry : entries)
     {
-        emit progress(i, numEntries);
-        zip_stat_t stat;
-        if (zip_stat_index(zip, i, 0, &stat) != 0)
+        QString entryName = entry.path;
+        if (!rootFolder.isEmpty() && entryName.startsWith(rootFolder))
+        {
+            entryName = entryName.mid(rootFolder.length());
+        }
+        QString cleaned = QDir::cleanPath(entryName);
+        if (entryName.isEmpty() || cleaned == ".")
+        {
+            continue; // The root folder entry itself
+        }
+        if (cleaned.startsWith('/') || cleaned == ".." || cleaned.startsWith("../") || cleaned.contains(':'))
         {
-            emit log("Unzip: Error getting info on file at index " + QString::number(i));
+            emit log("Unzip: Skipping unsafe path " + entry.path);
             continue;
         }
+        if (!filter.accepts(cleaned))
+        {
+            filtered += entryName.endsWith('/') ? 0 : 1;
+            continue;
+        }
+        entry.path = stagingPath + '/' + cleaned;
+        entry.name = cleaned;
+        if (entryName.endsWith('/'))
+        {
+            dirs.insert(entry.path);
+            continue;
+        }
+        installed.append(entry);
+        archiveFiles.insert(cleaned);
+        if (useIndex && index.matches(cleaned, entry.size, entry.crc))
+        {
+            continue;
+        }
+        dirs.insert(QFileInfo(entry.path).path());
+        files.append(entry);
+        totalBytes += entry.size;
+    }
+    if (filtered > 0)
+    {
+        emit log(QString("Skipping %1 files outside the install profile").arg(filtered));
+    }
+    if (useIndex)
+    {
+        emit log(QString("%1 of %2 files changed").arg(files.size()).arg(installed.size()));
+    }
+    for (const QString &dir : std::as_const(dirs))
+    {
+        QDir().mkpath(dir);
+    }
 
-        QString entryName(stat.name);
-        // Strip root folder if present
-        if (!rootFolder.isEmpty() && entryName.startsWith(rootFolder))
+    // Largest first to the least loaded worker keeps the shares even
+    // without splitting any entry
+    int workerCount = qBound(1, QThread::idealThreadCount(), UNZIP_MAX_WORKERS);
+    workerCount = qMax(1, qMin(workerCount, static_cast<int>(files.size())));
+    std::sort(files.begin(), files.end(), [](const Entry &a, const Entry &b) {
+        return a.compressedSize > b.compressedSize;
+    });
+    QList<QList<Entry>> shares(workerCount);
+    QList<qint64> loads(workerCount, 0);
+    for (const Entry &entry : std::as_const(files))
+    {
+        int lightest = static_cast<int>(std::min_element(loads.begin(), loads.end()) - loads.begin());
+        shares[lightest].append(entry);
+        loads[lightest] += entry.compressedSize;
+    }
+    // Within a share, entries of one directory follow each other
+    for (QList<Entry> &share : shares)
+    {
+        std::sort(share.begin(), share.end(), [](const Entry &a, const Entry &b) { return a.path < b.path; });
+    }
+
+    extractedBytes = 0;
+    workerFailed = false;
+    emit progress(0, totalBytes);
+    QList<QThread *> workers;
+    for (const QList<Entry> &share : std::as_const(shares))
+    {
+        QThread *worker = QThread::create([this, share]() { extractEntries(share); });
+        workers.append(worker);
+        worker->start();
+    }
+    for (QThread *worker : std::as_const(workers))
+    {
+        while (!worker->wait(QDeadlineTimer(UNZIP_PROGRESS_INTERVAL)))
         {
-            entryName = entryName.mid(rootFolder.length());
-            if (entryName.isEmpty())
+            emit progress(extractedBytes, totalBytes);
+        }
+        delete worker;
+    }
+
+    if (archiveData != nullptr)
+    {
+        archive.unmap(const_cast<uchar *>(archiveData));
+        archiveData = nullptr;
+    }
+    archive.close();
+    if (workerFailed)
+    {
+        QDir(stagingPath).removeRecursively();
+        emit unzip_fail("Unzip: Extraction failed, installed files were left unchanged");
+        return;
+    }
+    emit progress(totalBytes, totalBytes);
+
+#if defined(Q_OS_LINUX)
+    // One barrier for every file written instead of an fsync per file
+    int stagingFd = ::open(QFile::encodeName(stagingPath).constData(), O_RDONLY | O_DIRECTORY);
+    if (stagingFd >= 0)
+    {
+        syncfs(stagingFd);
+        ::close(stagingFd);
+    }
+#endif
+
+    // Everything the new files replace goes to the trash, so a failure part
+    // way through can be undone; deleteInBackground() empties it later
+    InstallSwap swap(trashPath(destPath));
+    bool swapped = true;
+    if (useIndex)
+    {
+        // Unchanged files stay where they are, so owned directories are
+        // pruned instead of swapped
+        swapped = removeObsolete(index, archiveFiles, swap);
+    }
+    else
+    {
+        for (const QString &dir : std::as_const(cleanDirs))
+        {
+            if (!swap.replaceDirectory(stagingPath + '/' + dir, destPath + '/' + dir))
             {
-                continue; // Skip the root folder entry itself
+                swapped = false;
+                break;
             }
         }
+    }
+    swapped = swapped && swap.moveTree(stagingPath, destPath);
+    if (!swapped)
+    {
+        swap.rollback();
+        QDir(stagingPath).removeRecursively();
+        emit unzip_fail("Unzip: " + swap.errorMessage() + ", installed files were left unchanged");
+        return;
+    }
+    QDir(stagingPath).removeRecursively();
 
-        QString outPath = destPath + '/' + entryName;
+    if (incremental)
+    {
+        index.clear();
+        for (const Entry &entry : std::as_const(installed))
+        {
+            index.insert(entry.name, entry.size, entry.crc);
+        }
+        if (!index.save())
+        {
+            emit log("Unzip: Error writing " INSTALL_INDEX_FILE);
+        }
+    }
+    emit log(QString("Unzip complete (%1 threads)").arg(workerCount));
+    emit unzip_complete(destPath);
+}
+
+QString UnzipThread::trashPath(const QString &destPath)
+{
+    return destPath + "/" UNZIP_TRASH_DIR;
+}
+
+void UnzipThread::deleteInBackground(const QString &path)
+{
+    if (!QFileInfo::exists(path))
+    {
+        return;
+    }
+    QThread *thread = QThread::create([path]() { QDir(path).removeRecursively(); });
+    connect(thread, &QThread::finished, thread, &QObject::deleteLater);
+    thread->start(QThread::LowestPriority);
+}
 
-        if (stat.name[strlen(stat.name) - 1] == '/')
+bool UnzipThread::removeObsolete(const InstallIndex &index, const QSet<QString> &archiveFiles, InstallSwap &swap)
+{
+    QSet<QString> obsolete;
+    const QStringList indexed = index.paths();
+    for (const QString &path : indexed)
+    {
+        // Files the profile leaves out stay as they are
+        if (!archiveFiles.contains(path) && filter.accepts(path))
         {
-            QDir().mkpath(outPath);
-            continue;
+            obsolete.insert(path);
+        }
+    }
+    for (const QString &dir : std::as_const(cleanDirs))
+    {
+        QDirIterator it(destPath + '/' + dir, QDir::Files | QDir::Hidden | QDir::System, QDirIterator::Subdirectories);
+        while (it.hasNext())
+        {
+            QString path = it.next().mid(destPath.length() + 1);
+            if (!archiveFiles.contains(path))
+            {
+                obsolete.insert(path);
+            }
+        }
+    }
+    for (const QString &path : std::as_const(obsolete))
+    {
+        if (!swap.discard(destPath + '/' + path))
+        {
+            return false;
         }
+    }
+    if (!obsolete.isEmpty())
+    {
+        emit log(QString("Removed %1 files that are no longer in the archive").arg(obsolete.size()));
+    }
+    return true;
+}
 
-        // Ensure parent directory exists
-        QFileInfo(outPath).dir().mkpath(".");
+bool UnzipThread::mapArchive(QList<Entry> *entries)
+{
+    archive.setFileName(fileName);
+    if (!archive.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+    archiveSize = archive.size();
+    archiveData = archiveSize > 0 ? archive.map(0, archiveSize) : nullptr;
+    if (archiveData == nullptr)
+    {
+        archive.close();
+        return false;
+    }
 
-        QSaveFile out(outPath);
-        if (!out.open(QIODevice::WriteOnly))
+    qint64 tailLength = qMin<qint64>(archiveSize, ZIP_MAX_TAIL_SIZE);
+    QByteArray tail = QByteArray::fromRawData(reinterpret_cast<const char *>(archiveData + archiveSize - tailLength), tailLength);
+    qint64 directoryOffset = 0;
+    qint64 directorySize = 0;
+    QList<ZipEntry> directory;
+    if (!ZipDirectory::findCentralDirectory(tail, archiveSize - tailLength, &directoryOffset, &directorySize) ||
+        directoryOffset < 0 || directorySize <= 0 || directoryOffset + directorySize > archiveSize ||
+        !ZipDirectory::parseCentralDirectory(QByteArray::fromRawData(reinterpret_cast<const char *>(archiveData + directoryOffset),
+                                                                     directorySize),
+                                             &directory))
+    {
+        archive.unmap(const_cast<uchar *>(archiveData));
+        archiveData = nullptr;
+        archive.close();
+        return false;
+    }
+
+    // Central directory order is libzip's index order
+    for (int i = 0; i < directory.size(); i++)
+    {
+        const ZipEntry &info = directory[i];
+        entries->append(Entry{static_cast<zip_uint64_t>(i), info.name, static_cast<qint64>(info.uncompressedSize),
+                              static_cast<qint64>(info.compressedSize), info.crc, info, QString()});
+    }
+    return true;
+}
+
+void UnzipThread::extractEntries(const QList<Entry> &entries)
+{
+    zip_t *zip = nullptr;
+    QByteArray buffer;
+    QHash<QString, int> directories;
+    Inflater inflater;
+
+    for (const Entry &entry : entries)
+    {
+        // One failed entry fails the whole extraction, the rest is wasted work
+        if (workerFailed)
         {
-            emit log("Unzip: Error creating file " + entryName);
-            continue;
+            break;
         }
-        zip_file_t *in = zip_fopen_index(zip, i, 0);
-        if (in == NULL)
+        if (extractMapped(entry, buffer, directories, inflater))
         {
-            emit log("Unzip: Failed to open " + entryName);
             continue;
         }
-        int len = zip_fread(in, buf, UNZIP_BUFFER_SIZE);
-        bool writeError = false;
-        while (len > 0)
+        if (zip == nullptr)
+        {
+            int error = 0;
+            zip = zip_open(fileName.toLocal8Bit(), ZIP_RDONLY, &error);
+            if (zip == NULL)
+            {
+                workerFailed = true;
+                break;
+            }
+        }
+        extractWithLibzip(zip, entry, buffer, inflater);
+    }
+    if (zip != nullptr)
+    {
+        zip_discard(zip);
+    }
+#if defined(Q_OS_UNIX)
+    for (int fd : std::as_const(directories))
+    {
+        ::close(fd);
+    }
+#endif
+}
+
+bool UnzipThread::extractMapped(const Entry &entry, QByteArray &buffer, QHash<QString, int> &directories,
+                                Inflater &inflater)
+{
+    const ZipEntry &info = entry.info;
+    if (archiveData == nullptr || (info.flags & 0x0001) || (info.method != 0 && info.method != 8))
+    {
+        return false;
+    }
+    qint64 headerOffset = static_cast<qint64>(info.localHeaderOffset);
+    if (headerOffset < 0 || headerOffset + ZIP_LOCAL_HEADER_SIZE > archiveSize ||
+        ZipDirectory::le32(archiveData + headerOffset) != ZIP_LOCAL_HEADER_SIGNATURE)
+    {
+        return false;
+    }
+    qint64 dataOffset = headerOffset + ZipDirectory::localHeaderLength(archiveData + headerOffset);
+    if (dataOffset + entry.compressedSize > archiveSize || (info.method == 0 && entry.compressedSize != entry.size))
+    {
+        return false;
+    }
+    const uchar *data = archiveData + dataOffset;
+#if defined(Q_OS_UNIX)
+    if (entry.size < UNZIP_SMALL_FILE_SIZE)
+    {
+        writeSmallFile(entry, data, buffer, directories, inflater);
+        return true;
+    }
+#else
+    Q_UNUSED(directories);
+#endif
+    QString entryName = QFileInfo(entry.path).fileName();
+
+    // Read/write: a writable shared mapping needs both
+    QFile out(entry.path);
+    if (!out.open(QIODevice::ReadWrite | QIODevice::Truncate))
+    {
+        emit log("Unzip: Error creating file " + entryName);
+        workerFailed = true;
+        return true;
+    }
+    bool ok = true;
+#if defined(Q_OS_LINUX)
+    // Reserve the blocks up front: less fragmentation, and a full disk is
+    // an error here rather than a SIGBUS in the mapped write below
+    if (entry.size > 0 && posix_fallocate(out.handle(), 0, entry.size) != 0)
+    {
+        emit log("Unzip: Not enough space for " + entryName);
+        workerFailed = true;
+        return true;
+    }
+    const bool mapOutput = true;
+#elif defined(Q_OS_MACOS)
+    // The same on macOS, where resize() alone leaves a sparse file
+    fstore_t store = {F_ALLOCATECONTIG | F_ALLOCATEALL, F_PEOFPOSMODE, 0, entry.size, 0};
+    if (entry.size > 0 && fcntl(out.handle(), F_PREALLOCATE, &store) == -1)
+    {
+        store.fst_flags = F_ALLOCATEALL;
+        if (fcntl(out.handle(), F_PREALLOCATE, &store) == -1)
+        {
+            emit log("Unzip: Not enough space for " + entryName);
+            workerFailed = true;
+            return true;
+        }
+    }
+    const bool mapOutput = true;
+#elif defined(Q_OS_WIN)
+    // Extending a file allocates its clusters, so resize() fails on a full disk
+    const bool mapOutput = true;
+#else
+    // Nothing reserves the blocks, and a mapped write to a full disk is a SIGBUS
+    const bool mapOutput = false;
+#endif
+
+    quint32 crc = 0;
+    if (info.method == 0)
+    {
+        crc = Inflater::crc32(data, entry.size);
+        qint64 copied = 0;
+#if defined(Q_OS_LINUX)
+        // Kernel to kernel, the data never passes through this process
+        off64_t sourceOffset = dataOffset;
+        off64_t targetOffset = 0;
+        while (copied < entry.size)
         {
-            if (out.write(buf, len) == -1)
+            ssize_t n = copy_file_range(archive.handle(), &sourceOffset, out.handle(), &targetOffset,
+                                        entry.size - copied, 0);
+            if (n <= 0)
             {
-                emit log("Unzip: Error writing to file " + entryName);
-                writeError = true;
                 break;
             }
-            len = zip_fread(in, buf, UNZIP_BUFFER_SIZE);
+            copied += n;
         }
-        if (len == -1)
+#endif
+        // Whatever copy_file_range did not do (other platforms, file
+        // systems without support) is written from the mapping
+        if (copied < entry.size && (!out.seek(copied) ||
+                                    out.write(reinterpret_cast<const char *>(data) + copied, entry.size - copied) != entry.size - copied))
         {
-            emit log("Unzip: Error reading from file " + entryName);
+            ok = false;
         }
-        else if (!writeError)
+    }
+    else if (entry.size >= UNZIP_MAP_THRESHOLD && mapOutput)
+    {
+        // Inflate straight into the page cache of the output file instead
+        // of a buffer that would then have to be written out
+        uchar *target = out.resize(entry.size) ? out.map(0, entry.size) : nullptr;
+        if (target != nullptr)
         {
-            out.commit();
+            ok = inflater.inflate(data, entry.compressedSize, target, entry.size);
+            if (ok)
+            {
+                crc = Inflater::crc32(target, entry.size);
+            }
+            out.unmap(target);
         }
-        if (zip_fclose(in) != 0)
+        else
         {
-            emit log("Unzip: Error closing file " + entryName);
+            ok = false;
         }
     }
-    zip_discard(zip);
-    emit log("Unzip complete");
-    emit unzip_complete(destPath);
+    else
+    {
+        if (buffer.size() < entry.size)
+        {
+            buffer.resize(entry.size);
+        }
+        uchar *target = reinterpret_cast<uchar *>(buffer.data());
+        ok = entry.size == 0 || inflater.inflate(data, entry.compressedSize, target, entry.size);
+        if (ok)
+        {
+            crc = Inflater::crc32(target, entry.size);
+            ok = out.write(buffer.constData(), entry.size) == entry.size;
+        }
+    }
+
+    if (!ok)
+    {
+        emit log("Unzip: Error extracting " + entryName);
+        workerFailed = true;
+        return true;
+    }
+    if (crc != info.crc)
+    {
+        emit log("Unzip: CRC mismatch for " + entryName);
+        workerFailed = true;
+        return true;
+    }
+    extractedBytes += entry.size;
+    return true;
+}
+
+#if defined(Q_OS_UNIX)
+void UnzipThread::writeSmallFile(const Entry &entry, const uchar *data, QByteArray &buffer,
+                                 QHash<QString, int> &directories, Inflater &inflater)
+{
+    int slash = entry.path.lastIndexOf('/');
+    QString dir = entry.path.left(slash);
+    QByteArray name = QFile::encodeName(entry.path.mid(slash + 1));
+
+    const uchar *content = data;
+    if (entry.info.method == 8)
+    {
+        if (buffer.size() < entry.size)
+        {
+            buffer.resize(entry.size);
+        }
+        content = reinterpret_cast<const uchar *>(buffer.constData());
+        if (entry.size > 0 && !inflater.inflate(data, entry.compressedSize, reinterpret_cast<uchar *>(buffer.data()), entry.size))
+        {
+            emit log("Unzip: Error extracting " + QString::fromLocal8Bit(name));
+            workerFailed = true;
+            return;
+        }
+    }
+    if (Inflater::crc32(content, entry.size) != entry.info.crc)
+    {
+        emit log("Unzip: CRC mismatch for " + QString::fromLocal8Bit(name));
+        workerFailed = true;
+        return;
+    }
+
+    // Files are created relative to a cached directory descriptor, so the
+    // kernel does not walk the whole path again for every one of them
+    int dirFd = directories.value(dir, -1);
+    if (dirFd < 0)
+    {
+        if (directories.size() >= UNZIP_MAX_DIRECTORY_FDS)
+        {
+            for (int fd : std::as_const(directories))
+            {
+                ::close(fd);
+            }
+            directories.clear();
+        }
+        dirFd = ::open(QFile::encodeName(dir).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (dirFd < 0)
+        {
+            emit log("Unzip: Error opening directory " + dir);
+            workerFailed = true;
+            return;
+        }
+        directories.insert(dir, dirFd);
+    }
+    int fd = ::openat(dirFd, name.constData(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (fd < 0)
+    {
+        emit log("Unzip: Error creating file " + QString::fromLocal8Bit(name));
+        workerFailed = true;
+        return;
+    }
+    qint64 written = 0;
+    while (written < entry.size)
+    {
+        ssize_t n = ::write(fd, content + written, entry.size - written);
+        if (n <= 0)
+        {
+            break;
+        }
+        written += n;
+    }
+    ::close(fd);
+    if (written != entry.size)
+    {
+        emit log("Unzip: Error writing to file " + QString::fromLocal8Bit(name));
+        workerFailed = true;
+        return;
+    }
+    extractedBytes += entry.size;
+}
+#endif
+
+bool UnzipThread::extractWithLibzip(zip_t *zip, const Entry &entry, QByteArray &buffer, Inflater &inflater)
+{
+    if (entry.info.method == 8 && !(entry.info.flags & 0x0001))
+    {
+        return inflateWithLibzip(zip, entry, buffer, inflater);
+    }
+    if (buffer.size() < UNZIP_BUFFER_SIZE)
+    {
+        buffer.resize(UNZIP_BUFFER_SIZE);
+    }
+    char *buf = buffer.data();
+    QString entryName = QFileInfo(entry.path).fileName();
+    QFile out(entry.path);
+    if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        emit log("Unzip: Error creating file " + entryName);
+        workerFailed = true;
+        return false;
+    }
+    zip_file_t *in = zip_fopen_index(zip, entry.index, 0);
+    if (in == NULL)
+    {
+        emit log("Unzip: Failed to open " + entryName);
+        workerFailed = true;
+        return false;
+    }
+    zip_int64_t len = zip_fread(in, buf, UNZIP_BUFFER_SIZE);
+    bool writeError = false;
+    while (len > 0)
+    {
+        if (out.write(buf, len) == -1)
+        {
+            emit log("Unzip: Error writing to file " + entryName);
+            writeError = true;
+            break;
+        }
+        extractedBytes += len;
+        len = zip_fread(in, buf, UNZIP_BUFFER_SIZE);
+    }
+    if (len == -1)
+    {
+        emit log("Unzip: Error reading from file " + entryName);
+    }
+    if (zip_fclose(in) != 0)
+    {
+        emit log("Unzip: Error closing file " + entryName);
+    }
+    if (len == -1 || writeError)
+    {
+        workerFailed = true;
+        return false;
+    }
+    return true;
+}
+
+bool UnzipThread::inflateWithLibzip(zip_t *zip, const Entry &entry, QByteArray &buffer, Inflater &inflater)
+{
+    // The raw deflate bytes are read and decoded in one call rather than
+    // through zip_fread's streaming zlib
+    QString entryName = QFileInfo(entry.path).fileName();
+    QByteArray compressed(entry.compressedSize, Qt::Uninitialized);
+    zip_file_t *in = zip_fopen_index(zip, entry.index, ZIP_FL_COMPRESSED);
+    if (in == NULL)
+    {
+        emit log("Unzip: Failed to open " + entryName);
+        workerFailed = true;
+        return false;
+    }
+    qint64 read = 0;
+    while (read < entry.compressedSize)
+    {
+        zip_int64_t len = zip_fread(in, compressed.data() + read, entry.compressedSize - read);
+        if (len <= 0)
+        {
+            break;
+        }
+        read += len;
+    }
+    zip_fclose(in);
+
+    if (buffer.size() < entry.size)
+    {
+        buffer.resize(entry.size);
+    }
+    uchar *target = reinterpret_cast<uchar *>(buffer.data());
+    if (read != entry.compressedSize ||
+        (entry.size > 0 && !inflater.inflate(reinterpret_cast<const uchar *>(compressed.constData()), read, target, entry.size)))
+    {
+        emit log("Unzip: Error extracting " + entryName);
+        workerFailed = true;
+        return false;
+    }
+    if (Inflater::crc32(target, entry.size) != entry.crc)
+    {
+        emit log("Unzip: CRC mismatch for " + entryName);
+        workerFailed = true;
+        return false;
+    }
+    QFile out(entry.path);
+    if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate) || out.write(buffer.constData(), entry.size) != entry.size)
+    {
+        emit log("Unzip: Error writing to file " + entryName);
+        workerFailed = true;
+        return false;
+    }
+    extractedBytes += entry.size;
+    return true;
 }
@@ -3,24 +3,107 @@
 
 #include <QDir>
 #include <QFileInfo>
-#include <QSaveFile>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QSet>
 #include <QString>
+#include <QStringList>
 #include <QThread>
+#include <atomic>
 #include <zip.h>
+#include "inflater.h"
+#include "installfilter.h"
+#include "installindex.h"
+#include "installswap.h"
+#include "zipdirectory.h"
 
-#define UNZIP_BUFFER_SIZE 1024
+#define UNZIP_BUFFER_SIZE (1024 * 1024)
+#define UNZIP_MAX_WORKERS 16
+#define UNZIP_PROGRESS_INTERVAL 100
+// Deflated entries at least this large are inflated straight into a
+// mapping of the output file
+#define UNZIP_MAP_THRESHOLD (1024 * 1024)
+// Smaller entries skip QFile and are written with one openat() and write()
+#define UNZIP_SMALL_FILE_SIZE (64 * 1024)
+#define UNZIP_MAX_DIRECTORY_FDS 64
+#define UNZIP_STAGING_DIR ".unzip-staging"
+#define UNZIP_TRASH_DIR ".unzip-trash"
 
+// Extracts a zip archive on a pool of worker threads. The central directory
+// is read once; entries are then dealt out to the workers largest first,
+// each going to the worker with the least compressed data so far.
+//
+// The archive is memory-mapped. Stored entries (most jars) are copied from
+// their offset in the archive with copy_file_range where available, and
+// deflated ones are inflated from the mapping into a buffer sized to the
+// entry, or into the mapped output file for large entries, which is
+// preallocated to its final size. Entries the mapping cannot handle
+// (encrypted, other methods) go through a libzip handle of the worker's own.
+//
+// With stripRoot a folder shared by every entry is dropped from the paths.
+// Files are extracted into <destPath>/.unzip-staging and only moved into
+// place once all of them were written, so a failure leaves the installed
+// files alone. cleanDirs (relative to destPath) are replaced as a whole by
+// a rename. Moving into place is an InstallSwap: the old copies go to
+// <destPath>/.unzip-trash for deleteInBackground() to remove when nothing is
+// waiting on the disk, and a failed rename puts everything back.
+//
+// With setIncremental() the installed files are tracked in an InstallIndex.
+// Once one exists, entries whose size and CRC match the installed copy are
+// skipped, only the rest is staged and moved over, and files that are no
+// longer in the archive (indexed ones, and any under cleanDirs) are removed.
+//
+// setFilter() leaves out entries the install profile does not select; see
+// InstallFilter for what that means for files already on disk.
 class UnzipThread : public QThread
 {
     Q_OBJECT
 public:
-    UnzipThread(QString fileName, QString destPath, bool stripRoot = true);
+    UnzipThread(QString fileName, QString destPath, bool stripRoot = true,
+                const QStringList &cleanDirs = QStringList());
     void run() override;
+    void setIncremental(bool incremental);
+    void setFilter(const InstallFilter &filter);
+
+    static QString trashPath(const QString &destPath);
+    // Removes path on a lowest-priority thread
+    static void deleteInBackground(const QString &path);
 
 private:
+    struct Entry
+    {
+        zip_uint64_t index;
+        QString path;
+        qint64 size;
+        qint64 compressedSize;
+        quint32 crc;
+        ZipEntry info;       // Valid when the archive is mapped
+        QString name;        // Relative to destPath
+    };
+
     QString fileName;
     QString destPath;
     bool stripRoot;
+    QStringList cleanDirs;
+    bool incremental = false;
+    InstallFilter filter;
+    std::atomic<qint64> extractedBytes{0};
+    std::atomic<bool> workerFailed{false};
+    QFile archive;
+    const uchar *archiveData = nullptr;
+    qint64 archiveSize = 0;
+
+    bool mapArchive(QList<Entry> *entries);
+    bool removeObsolete(const InstallIndex &index, const QSet<QString> &archiveFiles, InstallSwap &swap);
+    void extractEntries(const QList<Entry> &entries);
+    bool extractMapped(const Entry &entry, QByteArray &buffer, QHash<QString, int> &directories, Inflater &inflater);
+#if defined(Q_OS_UNIX)
+    void writeSmallFile(const Entry &entry, const uchar *data, QByteArray &buffer, QHash<QString, int> &directories,
+                        Inflater &inflater);
+#endif
+    bool extractWithLibzip(zip_t *zip, const Entry &entry, QByteArray &buffer, Inflater &inflater);
+    bool inflateWithLibzip(zip_t *zip, const Entry &entry, QByteArray &buffer, Inflater &inflater);
 
 signals:
     void log(QString message);
@@ -0,0 +1,284 @@
+#include "updatestager.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include "installindex.h"
+#include "installswap.h"
+#include "unzipthread.h"
+
+UpdateStager::UpdateStager(NetworkService *network, const QString &buildPath, QObject *parent)
+    : QObject(parent)
+{
+    this->network = network;
+    this->buildPath = buildPath;
+    this->stagingPath = buildPath + "/" UPDATE_STAGING_DIR;
+}
+
+UpdateStager::~UpdateStager()
+{
+    cleanUp();
+}
+
+void UpdateStager::cleanUp()
+{
+    if (stream != nullptr)
+    {
+        disconnect(stream, nullptr, this, nullptr);
+        stream->abort();
+        stream->wait();
+        stream = nullptr;
+    }
+    if (download != nullptr)
+    {
+        delete download;
+        download = nullptr;
+    }
+    if (updater != nullptr)
+    {
+        delete updater;
+        updater = nullptr;
+    }
+}
+
+QString UpdateStager::version() const
+{
+    return stagingVersion;
+}
+
+QString UpdateStager::profile() const
+{
+    return filter.key();
+}
+
+void UpdateStager::setMirrors(const QList<QUrl> &mirrors)
+{
+    this->mirrors = mirrors;
+}
+
+void UpdateStager::setFilter(const InstallFilter &filter)
+{
+    this->filter = filter;
+}
+
+void UpdateStager::setManagedDirs(const QStringList &managedDirs)
+{
+    this->managedDirs = managedDirs;
+}
+
+void UpdateStager::stage(const QUrl &url, const QString &version, const QByteArray &sha256)
+{
+    stagingVersion = version;
+    stagingUrl = url;
+    stagingSha256 = sha256;
+
+    // Whatever is left from an older or interrupted staging is useless now
+    QDir(stagingPath).removeRecursively();
+    QDir().mkpath(stagingPath);
+
+    if (TarStreamThread::isTarArchive(url.fileName()))
+    {
+        stageArchive();
+        return;
+    }
+    updater = new ZipRangeUpdater(network, url, buildPath, managedDirs, this);
+    updater->setStageOnly(stagingPath);
+    updater->setFilter(filter);
+    updater->setPriority(TransferScheduler::Background);
+    connect(updater, &ZipRangeUpdater::log, this, &UpdateStager::log);
+    connect(updater, &ZipRangeUpdater::update_complete, this, &UpdateStager::range_complete);
+    connect(updater, &ZipRangeUpdater::update_fail, this, &UpdateStager::range_failed);
+    updater->start();
+}
+
+void UpdateStager::range_complete()
+{
+    QStringList obsolete = updater->obsolete();
+    QJsonArray files = updater->indexedFiles();
+    updater->deleteLater();
+    updater = nullptr;
+    writeMarker(true, obsolete, files);
+}
+
+void UpdateStager::range_failed(QString errorMessage)
+{
+    updater->deleteLater();
+    updater = nullptr;
+    emit log("Partial update not possible (" + errorMessage + "), downloading the full archive in the background");
+    QDir(stagingPath).removeRecursively();
+    QDir().mkpath(stagingPath);
+    stageArchive();
+}
+
+void UpdateStager::stageArchive()
+{
+    QUrl url = stagingUrl;
+    bool tar = TarStreamThread::isTarArchive(url.fileName());
+    if (tar)
+    {
+        stream = new TarStreamThread(stagingPath, true);
+    }
+    else
+    {
+        stream = new ZipStreamThread(stagingPath);
+    }
+    stream->setFilter(filter);
+    connect(stream, &StreamExtractThread::extract_complete, this, &UpdateStager::extract_complete);
+    connect(stream, &StreamExtractThread::extract_fail, this, &UpdateStager::extract_failed);
+    connect(stream, &StreamExtractThread::finished, stream, &QObject::deleteLater);
+
+    download = new FileDownload(network, url, stagingPath + (tar ? "/xmage.tar" : "/xmage.zip"), this);
+    download->setStreamConsumer(stream);
+    download->setPriority(TransferScheduler::Background);
+    download->setMirrors(mirrors);
+    if (!stagingSha256.isEmpty())
+    {
+        download->setExpectedSha256(stagingSha256);
+    }
+    else
+    {
+        download->setChecksumUrl(QUrl(url.toString() + ".sha256"));
+    }
+    connect(download, &FileDownload::download_fail, this, &UpdateStager::download_failed);
+    stream->start();
+    download->start();
+}
+
+void UpdateStager::download_failed(QString errorMessage)
+{
+    cleanUp();
+    QDir(stagingPath).removeRecursively();
+    emit stage_fail(errorMessage);
+}
+
+void UpdateStager::extract_failed(QString errorMessage)
+{
+    stream = nullptr;
+    cleanUp();
+    QDir(stagingPath).removeRecursively();
+    emit stage_fail(errorMessage);
+}
+
+void UpdateStager::extract_complete(QString)
+{
+    stream = nullptr;
+    download->deleteLater();
+    download = nullptr;
+    // A streamed zip brings its own InstallIndex along in the staged tree
+    writeMarker(false, QStringList(), QJsonArray());
+}
+
+void UpdateStager::writeMarker(bool partial, const QStringList &obsolete, const QJsonArray &files)
+{
+    // Written last, so a staging directory without it is never applied
+    QJsonObject marker;
+    marker.insert("version", stagingVersion);
+    marker.insert("profile", filter.key());
+    // A partial build only has the changed files and replaces no directory
+    marker.insert("partial", partial);
+    marker.insert("obsolete", QJsonArray::fromStringList(obsolete));
+    marker.insert("files", files);
+    QSaveFile file(stagingPath + "/" UPDATE_STAGED_MARKER);
+    if (!file.open(QIODevice::WriteOnly) || file.write(QJsonDocument(marker).toJson()) < 0 || !file.commit())
+    {
+        QDir(stagingPath).removeRecursively();
+        emit stage_fail("Error writing " + file.fileName());
+        return;
+    }
+    emit stage_complete(stagingVersion);
+}
+
+QString UpdateStager::stagedVersion(const QString &buildPath)
+{
+    QFile file(buildPath + "/" UPDATE_STAGING_DIR "/" UPDATE_STAGED_MARKER);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return QString();
+    }
+    return QJsonDocument::fromJson(file.readAll()).object().value("version").toString();
+}
+
+QString UpdateStager::stagedProfile(const QString &buildPath)
+{
+    QFile file(buildPath + "/" UPDATE_STAGING_DIR "/" UPDATE_STAGED_MARKER);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return QString();
+    }
+    return QJsonDocument::fromJson(file.readAll()).object().value("profile").toString(InstallFilter().key());
+}
+
+bool UpdateStager::applyStaged(const QString &buildPath, const QStringList &managedDirs, QString *errorMessage)
+{
+    QString stagingPath = buildPath + "/" UPDATE_STAGING_DIR;
+    QString marker = stagingPath + "/" UPDATE_STAGED_MARKER;
+    QString markerBackup = buildPath + "/" UPDATE_STAGED_MARKER;
+    QFile markerFile(marker);
+    if (!markerFile.open(QIODevice::ReadOnly))
+    {
+        *errorMessage = "Error reading " + marker;
+        return false;
+    }
+    QJsonObject staged = QJsonDocument::fromJson(markerFile.readAll()).object();
+    markerFile.close();
+    // Set aside rather than removed, a failed swap keeps the staged build
+    QFile::remove(markerBackup);
+    if (!QFile::rename(marker, markerBackup))
+    {
+        *errorMessage = "Error moving " + marker;
+        return false;
+    }
+
+    bool stagedIndex = QFile::exists(stagingPath + "/" INSTALL_INDEX_FILE);
+
+    // The old copies are deleted in the background once the game is up
+    InstallSwap swap(UnzipThread::trashPath(buildPath));
+    bool swapped = true;
+    if (staged.value("partial").toBool())
+    {
+        const QJsonArray obsolete = staged.value("obsolete").toArray();
+        for (const QJsonValue &path : obsolete)
+        {
+            if (!swap.discard(buildPath + '/' + path.toString()))
+            {
+                swapped = false;
+                break;
+            }
+        }
+    }
+    else
+    {
+        for (const QString &dir : managedDirs)
+        {
+            QString stagedDir = stagingPath + '/' + dir;
+            // Directories the profile left out of the staged build stay as they are
+            if (QDir(stagedDir).exists() && !swap.replaceDirectory(stagedDir, buildPath + '/' + dir))
+            {
+                swapped = false;
+                break;
+            }
+        }
+    }
+    if (!swapped || !swap.moveTree(stagingPath, buildPath))
+    {
+        swap.rollback();
+        QFile::rename(markerBackup, marker);
+        *errorMessage = swap.errorMessage();
+        return false;
+    }
+    QFile::remove(markerBackup);
+    QDir(stagingPath).removeRecursively();
+    // The index is only worth keeping if it describes the new build
+    if (staged.value("partial").toBool())
+    {
+        ZipRangeUpdater::writeIndex(buildPath, staged.value("files").toArray());
+    }
+    else if (!stagedIndex)
+    {
+        QFile::remove(buildPath + "/" INSTALL_INDEX_FILE);
+    }
+    return true;
+}
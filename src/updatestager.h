@@ -0,0 +1,80 @@
+#ifndef UPDATESTAGER_H
+#define UPDATESTAGER_H
+
+#include <QString>
+#include <QJsonArray>
+#include <QStringList>
+#include <QUrl>
+#include "filedownload.h"
+#include "networkservice.h"
+#include "tarstreamthread.h"
+#include "ziprangeupdater.h"
+#include "zipstreamthread.h"
+
+#define UPDATE_STAGING_DIR ".update-staging"
+#define UPDATE_STAGED_MARKER ".staged.json"
+
+// Downloads a new XMage version in the background, at low priority, and
+// extracts it into <build>/.update-staging next to the installed one. The
+// next launch swaps the staged tree in with applyStaged() instead of
+// waiting for a download.
+//
+// For zips only the entries that differ from the installed build are
+// fetched over range requests (see ZipRangeUpdater); the marker then lists
+// the installed files the new version no longer has. Servers without range
+// support, and tarballs, get the whole archive streamed into staging.
+class UpdateStager : public QObject
+{
+    Q_OBJECT
+public:
+    UpdateStager(NetworkService *network, const QString &buildPath, QObject *parent = nullptr);
+    ~UpdateStager();
+    void setMirrors(const QList<QUrl> &mirrors);
+    void setFilter(const InstallFilter &filter);
+    void setManagedDirs(const QStringList &managedDirs);
+    void stage(const QUrl &url, const QString &version, const QByteArray &sha256);
+    QString version() const;
+    // InstallFilter::key() of what is being staged
+    QString profile() const;
+
+    // Version of a completely staged build, or an empty string
+    static QString stagedVersion(const QString &buildPath);
+    // InstallFilter::key() the staged build was extracted with
+    static QString stagedProfile(const QString &buildPath);
+    // Replaces managedDirs in buildPath with the staged copies and moves the
+    // remaining staged files over the installed ones. On failure both the
+    // install and the staged build are left as they were.
+    static bool applyStaged(const QString &buildPath, const QStringList &managedDirs, QString *errorMessage);
+
+signals:
+    void log(QString message);
+    void stage_complete(QString version);
+    void stage_fail(QString errorMessage);
+
+private:
+    NetworkService *network;
+    QString buildPath;
+    QString stagingPath;
+    QString stagingVersion;
+    QUrl stagingUrl;
+    QByteArray stagingSha256;
+    QList<QUrl> mirrors;
+    InstallFilter filter;
+    QStringList managedDirs;
+    ZipRangeUpdater *updater = nullptr;
+    FileDownload *download = nullptr;
+    StreamExtractThread *stream = nullptr;
+
+    void cleanUp();
+    void stageArchive();
+    void writeMarker(bool partial, const QStringList &obsolete, const QJsonArray &files);
+
+private slots:
+    void range_complete();
+    void range_failed(QString errorMessage);
+    void download_failed(QString errorMessage);
+    void extract_complete(QString installLocation);
+    void extract_failed(QString errorMessage);
+};
+
+#endif // UPDATESTAGER_H
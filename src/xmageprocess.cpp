@@ -1,30 +1,126 @@
 #include "xmageprocess.h"
 
-XMageProcess::XMageProcess(QPlainTextEdit *console)
+XMageProcess::XMageProcess(LogBuffer *console)
 {
     this->console = console;
-    connect(this, &QProcess::readyReadStandardOutput, this, &XMageProcess::standard_read);
-    connect(this, &QProcess::readyReadStandardError, this, &XMageProcess::error_read);
-    connect(this, &QProcess::errorOccurred, this, &XMageProcess::process_error);
-    connect(this, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this, &XMageProcess::xmage_quit);
+    process = new QProcess();
+    process->moveToThread(&readerThread);
+    // The lambdas run on the reader thread, where process lives
+    connect(process, &QProcess::readyReadStandardOutput, process, [this]() { standard_read(); });
+    connect(process, &QProcess::readyReadStandardError, process, [this]() { error_read(); });
+    connect(process, &QProcess::errorOccurred, process, [this]() { process_error(); });
+    connect(process, &QProcess::finished, process,
+            [this](int exitCode, QProcess::ExitStatus exitStatus) { xmage_quit(exitCode, exitStatus); });
+    connect(&readerThread, &QThread::finished, process, &QObject::deleteLater);
+    connect(this, &XMageProcess::finished, this, &QObject::deleteLater);
+    readerThread.start();
+}
+
+XMageProcess::~XMageProcess()
+{
+    readerThread.quit();
+    readerThread.wait();
+    if (sessionLog != nullptr)
+    {
+        // Waits for the last part to be compressed
+        sessionLog->finish();
+        sessionLog->wait();
+        delete sessionLog;
+    }
+}
+
+void XMageProcess::setWorkingDirectory(const QString &dir)
+{
+    QMetaObject::invokeMethod(process, [this, dir]() { process->setWorkingDirectory(dir); });
+}
+
+void XMageProcess::setSessionLog(const QString &dir, const QString &name)
+{
+    sessionLog = new SessionLogWriter(dir, name);
+    // The buffer is safe to use from the writer thread
+    connect(sessionLog, &SessionLogWriter::write_fail, sessionLog,
+            [this](QString errorMessage) { toConsole(QStringList("Session log: " + errorMessage)); }, Qt::DirectConnection);
+    sessionLog->start(QThread::LowPriority);
+}
+
+void XMageProcess::start(const QString &program, const QStringList &arguments)
+{
+    if (sessionLog != nullptr)
+    {
+        sessionLog->append((QStringList(program) << arguments).join(' '));
+    }
+    QMetaObject::invokeMethod(process, [this, program, arguments]() { process->start(program, arguments); });
+}
+
+void XMageProcess::terminate()
+{
+    QMetaObject::invokeMethod(process, [this]() { process->terminate(); });
+}
+
+void XMageProcess::kill()
+{
+    QMetaObject::invokeMethod(process, [this]() { process->kill(); });
+}
+
+void XMageProcess::detach()
+{
+    QMutexLocker locker(&consoleMutex);
+    console = nullptr;
+}
+
+void XMageProcess::toConsole(const QStringList &lines)
+{
+    QMutexLocker locker(&consoleMutex);
+    if (console != nullptr)
+    {
+        console->append(lines);
+    }
+}
+
+void XMageProcess::output(const QStringList &lines)
+{
+    toConsole(lines);
+    if (sessionLog != nullptr)
+    {
+        sessionLog->append(lines);
+    }
 }
 
 void XMageProcess::standard_read()
 {
-    console->appendPlainText(this->readAllStandardOutput());
+    output(standardLines.split(process->readAllStandardOutput()));
 }
 
 void XMageProcess::error_read()
 {
-    console->appendPlainText(this->readAllStandardError());
+    output(errorLines.split(process->readAllStandardError()));
 }
 
 void XMageProcess::process_error()
 {
-    console->appendPlainText(this->errorString());
+    output(QStringList(process->errorString()));
+    if (process->error() == QProcess::FailedToStart)
+    {
+        if (sessionLog != nullptr)
+        {
+            sessionLog->finish();
+        }
+        // No finished() follows a process that never ran
+        emit finished(-1, QProcess::CrashExit);
+    }
 }
 
-void XMageProcess::xmage_quit(int, QProcess::ExitStatus)
+void XMageProcess::xmage_quit(int exitCode, QProcess::ExitStatus exitStatus)
 {
-    this->deleteLater();
+    standard_read();
+    error_read();
+    output(standardLines.flush());
+    output(errorLines.flush());
+    if (sessionLog != nullptr)
+    {
+        sessionLog->append(exitStatus == QProcess::CrashExit ? QString("Process crashed")
+                                                            : QString("Exited with code %1").arg(exitCode));
+        sessionLog->finish();
+    }
+    emit finished(exitCode, exitStatus);
 }
@@ -1,23 +1,59 @@
 #ifndef XMAGEPROCESS_H
 #define XMAGEPROCESS_H
 
+#include <QMutex>
 #include <QProcess>
-#include <QPlainTextEdit>
+#include <QThread>
+#include "linesplitter.h"
+#include "logbuffer.h"
+#include "sessionlogwriter.h"
 
-class XMageProcess : public QProcess
+// Runs a client or server JVM. The QProcess lives on a reader thread of
+// its own, so however much the game prints, reading the pipes and splitting
+// the output into lines never happens on the GUI thread. Complete lines go
+// straight into the log buffer. finished() is delivered after the last
+// output was added to the log, and the object then deletes itself.
+//
+// With setSessionLog() the same lines, plus the command line and the exit
+// code, are also saved to disk by a SessionLogWriter of the session's own,
+// which is finished and waited for when this object is deleted.
+//
+// detach() stops the output from reaching the log buffer, for a process
+// that may outlive it; the session log still gets every line.
+class XMageProcess : public QObject
 {
     Q_OBJECT
 public:
-    XMageProcess(QPlainTextEdit *console);
+    XMageProcess(LogBuffer *console);
+    ~XMageProcess();
+    void setWorkingDirectory(const QString &dir);
+    // Call before start(); files are named after name, see SessionLogWriter
+    void setSessionLog(const QString &dir, const QString &name);
+    void start(const QString &program, const QStringList &arguments);
+    void terminate();
+    void kill();
+    void detach();
+
+signals:
+    void finished(int exitCode, QProcess::ExitStatus exitStatus);
 
 private:
-    QPlainTextEdit *console;
+    QMutex consoleMutex;
+    LogBuffer *console; // Null once detached
+    SessionLogWriter *sessionLog = nullptr;
+    QThread readerThread;
+    QProcess *process;
+    // Only touched on the reader thread
+    LineSplitter standardLines;
+    LineSplitter errorLines;
 
-private slots:
+    // Reader thread
+    void toConsole(const QStringList &lines);
+    void output(const QStringList &lines);
     void standard_read();
     void error_read();
     void process_error();
-    void xmage_quit(int, QProcess::ExitStatus);
+    void xmage_quit(int exitCode, QProcess::ExitStatus exitStatus);
 };
 
 #endif // XMAGEPROCESS_H
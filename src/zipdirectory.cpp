@@ -0,0 +1,156 @@
+#include "zipdirectory.h"
+#include <QtEndian>
+
+quint16 ZipDirectory::le16(const uchar *p)
+{
+    return qFromLittleEndian<quint16>(p);
+}
+
+quint32 ZipDirectory::le32(const uchar *p)
+{
+    return qFromLittleEndian<quint32>(p);
+}
+
+quint64 ZipDirectory::le64(const uchar *p)
+{
+    return qFromLittleEndian<quint64>(p);
+}
+
+bool ZipDirectory::findCentralDirectory(const QByteArray &tail, qint64 tailOffset,
+                                        qint64 *offset, qint64 *size)
+{
+    const uchar *p = reinterpret_cast<const uchar *>(tail.constData());
+    // The end record is 22 bytes plus a comment of up to 64 KB, so scan
+    // backwards for its signature
+    qint64 eocd = -1;
+    for (qint64 i = tail.size() - 22; i >= 0; i--)
+    {
+        if (le32(p + i) == ZIP_END_OF_CENTRAL_DIR_SIGNATURE &&
+            i + 22 + le16(p + i + 20) == tail.size())
+        {
+            eocd = i;
+            break;
+        }
+    }
+    if (eocd < 0)
+    {
+        return false;
+    }
+
+    *size = le32(p + eocd + 12);
+    *offset = le32(p + eocd + 16);
+    if (*size == 0xFFFFFFFF || *offset == 0xFFFFFFFF)
+    {
+        // Zip64: the locator just before the end record points at the
+        // zip64 end record, which has the real values
+        qint64 locator = eocd - 20;
+        if (locator < 0 || le32(p + locator) != ZIP64_END_OF_CENTRAL_DIR_LOCATOR_SIGNATURE)
+        {
+            return false;
+        }
+        qint64 record = static_cast<qint64>(le64(p + locator + 8)) - tailOffset;
+        if (record < 0 || record + 56 > tail.size() ||
+            le32(p + record) != ZIP64_END_OF_CENTRAL_DIR_SIGNATURE)
+        {
+            return false;
+        }
+        *size = le64(p + record + 40);
+        *offset = le64(p + record + 48);
+    }
+    return true;
+}
+
+bool ZipDirectory::parseCentralDirectory(const QByteArray &data, QList<ZipEntry> *entries)
+{
+    const uchar *p = reinterpret_cast<const uchar *>(data.constData());
+    qint64 size = data.size();
+    qint64 pos = 0;
+    while (pos + 46 <= size && le32(p + pos) == ZIP_CENTRAL_HEADER_SIGNATURE)
+    {
+        const uchar *header = p + pos;
+        quint16 nameLength = le16(header + 28);
+        quint16 extraLength = le16(header + 30);
+        quint16 commentLength = le16(header + 32);
+        if (pos + 46 + nameLength + extraLength + commentLength > size)
+        {
+            return false;
+        }
+
+        ZipEntry entry;
+        entry.flags = le16(header + 8);
+        entry.method = le16(header + 10);
+        entry.crc = le32(header + 16);
+        entry.compressedSize = le32(header + 20);
+        entry.uncompressedSize = le32(header + 24);
+        entry.externalAttributes = le32(header + 38);
+        entry.localHeaderOffset = le32(header + 42);
+        entry.name = QString::fromUtf8(reinterpret_cast<const char *>(header + 46), nameLength);
+
+        // Zip64 extra field: only the values saturated in the fixed header
+        // are present, in this order
+        const uchar *extra = header + 46 + nameLength;
+        int offset = 0;
+        while (offset + 4 <= extraLength)
+        {
+            quint16 id = le16(extra + offset);
+            quint16 length = le16(extra + offset + 2);
+            if (offset + 4 + length > extraLength)
+            {
+                break;
+            }
+            if (id == 0x0001)
+            {
+                const uchar *field = extra + offset + 4;
+                int fieldOffset = 0;
+                if (entry.uncompressedSize == 0xFFFFFFFF && fieldOffset + 8 <= length)
+                {
+                    entry.uncompressedSize = le64(field + fieldOffset);
+                    fieldOffset += 8;
+                }
+                if (entry.compressedSize == 0xFFFFFFFF && fieldOffset + 8 <= length)
+                {
+                    entry.compressedSize = le64(field + fieldOffset);
+                    fieldOffset += 8;
+                }
+                if (entry.localHeaderOffset == 0xFFFFFFFF && fieldOffset + 8 <= length)
+                {
+                    entry.localHeaderOffset = le64(field + fieldOffset);
+                }
+            }
+            offset += 4 + length;
+        }
+
+        entries->append(entry);
+        pos += 46 + nameLength + extraLength + commentLength;
+    }
+    return !entries->isEmpty();
+}
+
+QString ZipDirectory::commonRoot(const QList<ZipEntry> &entries)
+{
+    QString commonPrefix;
+    for (const ZipEntry &entry : entries)
+    {
+        int slashPos = entry.name.indexOf('/');
+        if (slashPos <= 0)
+        {
+            // Entry at root level - no common root
+            return QString();
+        }
+        QString prefix = entry.name.left(slashPos + 1);
+        if (commonPrefix.isEmpty())
+        {
+            commonPrefix = prefix;
+        }
+        else if (prefix != commonPrefix)
+        {
+            return QString();
+        }
+    }
+    return commonPrefix;
+}
+
+qint64 ZipDirectory::localHeaderLength(const uchar *localHeader)
+{
+    return ZIP_LOCAL_HEADER_SIZE + le16(localHeader + 26) + le16(localHeader + 28);
+}
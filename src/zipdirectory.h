@@ -0,0 +1,53 @@
+#ifndef ZIPDIRECTORY_H
+#define ZIPDIRECTORY_H
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+
+#define ZIP_LOCAL_HEADER_SIGNATURE 0x04034b50
+#define ZIP_DATA_DESCRIPTOR_SIGNATURE 0x08074b50
+#define ZIP_CENTRAL_HEADER_SIGNATURE 0x02014b50
+#define ZIP_END_OF_CENTRAL_DIR_SIGNATURE 0x06054b50
+#define ZIP64_END_OF_CENTRAL_DIR_SIGNATURE 0x06064b50
+#define ZIP64_END_OF_CENTRAL_DIR_LOCATOR_SIGNATURE 0x07064b50
+#define ZIP_LOCAL_HEADER_SIZE 30
+#define ZIP_MAX_TAIL_SIZE (65536 + 22 + 20 + 56)
+
+struct ZipEntry
+{
+    QString name;
+    quint16 flags;
+    quint16 method;
+    quint32 crc;
+    quint64 compressedSize;
+    quint64 uncompressedSize;
+    quint64 localHeaderOffset;
+    quint32 externalAttributes;
+
+    bool isDir() const { return name.endsWith('/'); }
+};
+
+// Parser for the zip central directory, for code that reads archives
+// without going through libzip (streamed or fetched over HTTP ranges).
+class ZipDirectory
+{
+public:
+    // Locates the central directory from the last bytes of an archive.
+    // tailOffset is the position of tail within the archive.
+    static bool findCentralDirectory(const QByteArray &tail, qint64 tailOffset,
+                                     qint64 *offset, qint64 *size);
+    // Parses consecutive central directory headers starting at data[0].
+    static bool parseCentralDirectory(const QByteArray &data, QList<ZipEntry> *entries);
+    // Returns the "root/" folder every entry lives under, or an empty string.
+    static QString commonRoot(const QList<ZipEntry> &entries);
+    // Length of a local file header including its name and extra field,
+    // i.e. where the entry's data starts relative to the header.
+    static qint64 localHeaderLength(const uchar *localHeader);
+
+    static quint16 le16(const uchar *p);
+    static quint32 le32(const uchar *p);
+    static quint64 le64(const uchar *p);
+};
+
+#endif // ZIPDIRECTORY_H
@@ -0,0 +1,794 @@
+#include "ziprangeupdater.h"
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QSet>
+#include <algorithm>
+#include <cstring>
+#include <zlib.h>
+#include "inflater.h"
+#include "installindex.h"
+#include "installswap.h"
+#include "unzipthread.h"
+
+ZipRangeUpdater::ZipRangeUpdater(NetworkService *network, const QUrl &url, const QString &destPath,
+                                 const QStringList &managedDirs, QObject *parent)
+    : QObject(parent)
+{
+    this->network = network;
+    this->url = url;
+    this->destPath = destPath;
+    this->managedDirs = managedDirs;
+    this->stagingPath = destPath + "/" RANGE_UPDATE_STAGING_DIR;
+}
+
+ZipRangeUpdater::~ZipRangeUpdater()
+{
+    for (QNetworkReply *reply : inFlight)
+    {
+        disconnect(reply, nullptr, this, nullptr);
+        reply->abort();
+        reply->deleteLater();
+    }
+    endTransfer();
+    stopWorker();
+}
+
+void ZipRangeUpdater::setFilter(const InstallFilter &filter)
+{
+    this->filter = filter;
+}
+
+void ZipRangeUpdater::setPriority(TransferScheduler::Priority priority)
+{
+    this->priority = priority;
+}
+
+void ZipRangeUpdater::setStageOnly(const QString &stagingPath)
+{
+    this->stagingPath = stagingPath;
+    stageOnly = true;
+}
+
+QStringList ZipRangeUpdater::obsolete() const
+{
+    QStringList paths;
+    for (const QString &path : obsoleteFiles)
+    {
+        paths.append(path.mid(destPath.length() + 1));
+    }
+    return paths;
+}
+
+QJsonArray ZipRangeUpdater::indexedFiles() const
+{
+    QJsonArray files;
+    for (const ZipEntry &entry : entries)
+    {
+        QString path = installPath(entry);
+        if (entry.isDir() || path.isEmpty())
+        {
+            continue;
+        }
+        path = path.mid(destPath.length() + 1);
+        if (filter.accepts(path))
+        {
+            files.append(QJsonArray{path, static_cast<qint64>(entry.uncompressedSize), static_cast<qint64>(entry.crc)});
+        }
+    }
+    return files;
+}
+
+bool ZipRangeUpdater::writeIndex(const QString &destPath, const QJsonArray &files)
+{
+    InstallIndex index(destPath);
+    for (const QJsonValue &value : files)
+    {
+        QJsonArray file = value.toArray();
+        index.insert(file[0].toString(), file[1].toInteger(), static_cast<quint32>(file[2].toInteger()));
+    }
+    return index.save();
+}
+
+QNetworkRequest ZipRangeUpdater::makeRequest(qint64 start, qint64 end) const
+{
+    QNetworkRequest request = network->request(url);
+    if (start < 0)
+    {
+        // Suffix range: the last -start bytes
+        request.setRawHeader("Range", QString("bytes=%1").arg(start).toLatin1());
+    }
+    else
+    {
+        request.setRawHeader("Range", QString("bytes=%1-%2").arg(start).arg(end).toLatin1());
+    }
+    return request;
+}
+
+void ZipRangeUpdater::start()
+{
+    emit log("Checking which XMage files changed...");
+    transferId = network->scheduler()->addTransfer(priority);
+    connect(network->scheduler(), &TransferScheduler::tokens_available, this, &ZipRangeUpdater::tokens_available);
+    QNetworkReply *reply = network->get(makeRequest(-RANGE_UPDATE_TAIL_SIZE, -1));
+    inFlight.insert(reply);
+    connect(reply, &QNetworkReply::finished, this, &ZipRangeUpdater::tail_finished);
+}
+
+QNetworkReply *ZipRangeUpdater::checkReply(QNetworkReply *reply)
+{
+    inFlight.remove(reply);
+    reply->deleteLater();
+    if (reply->error() != QNetworkReply::NoError)
+    {
+        fail("Network error: " + reply->errorString());
+        return nullptr;
+    }
+    if (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 206)
+    {
+        fail("Server does not support range requests");
+        return nullptr;
+    }
+    return reply;
+}
+
+void ZipRangeUpdater::tail_finished()
+{
+    QNetworkReply *reply = checkReply(qobject_cast<QNetworkReply *>(sender()));
+    if (reply == nullptr)
+    {
+        return;
+    }
+
+    // Content-Range: bytes <first>-<last>/<total>
+    static const QRegularExpression contentRange("bytes\\s+(\\d+)-(\\d+)/(\\d+)");
+    QRegularExpressionMatch match = contentRange.match(QString::fromLatin1(reply->rawHeader("Content-Range")));
+    if (!match.hasMatch())
+    {
+        fail("Missing Content-Range in server response");
+        return;
+    }
+    qint64 tailOffset = match.captured(1).toLongLong();
+    QByteArray tail = reply->readAll();
+
+    qint64 size = 0;
+    if (!ZipDirectory::findCentralDirectory(tail, tailOffset, &directoryOffset, &size))
+    {
+        fail("Could not find the zip central directory");
+        return;
+    }
+
+    if (directoryOffset >= tailOffset && directoryOffset + size <= tailOffset + tail.size())
+    {
+        parseDirectory(tail.mid(directoryOffset - tailOffset, size));
+    }
+    else
+    {
+        QNetworkReply *directoryReply = network->get(makeRequest(directoryOffset, directoryOffset + size - 1));
+        inFlight.insert(directoryReply);
+        connect(directoryReply, &QNetworkReply::finished, this, &ZipRangeUpdater::directory_finished);
+    }
+}
+
+void ZipRangeUpdater::directory_finished()
+{
+    QNetworkReply *reply = checkReply(qobject_cast<QNetworkReply *>(sender()));
+    if (reply != nullptr)
+    {
+        parseDirectory(reply->readAll());
+    }
+}
+
+void ZipRangeUpdater::parseDirectory(const QByteArray &directory)
+{
+    if (!ZipDirectory::parseCentralDirectory(directory, &entries))
+    {
+        fail("Error reading the zip central directory");
+        return;
+    }
+    rootFolder = ZipDirectory::commonRoot(entries);
+
+    // Checksumming the installed files reads the whole build, keep it off
+    // the GUI thread
+    worker = QThread::create([this]() { scanInstalled(); });
+    connect(worker, &QThread::finished, this, &ZipRangeUpdater::scan_finished);
+    worker->start();
+}
+
+QString ZipRangeUpdater::installPath(const ZipEntry &entry) const
+{
+    QString name = entry.name;
+    if (!rootFolder.isEmpty())
+    {
+        name = name.mid(rootFolder.length());
+    }
+    QString path = QDir::cleanPath(name);
+    if (path.isEmpty() || path == "." || path == ".." || path.startsWith("../") ||
+        QDir::isAbsolutePath(path) || path.contains(':'))
+    {
+        return QString();
+    }
+    return destPath + '/' + path;
+}
+
+bool ZipRangeUpdater::isCancelled()
+{
+    QMutexLocker locker(&mutex);
+    return cancelled;
+}
+
+void ZipRangeUpdater::scanInstalled()
+{
+    // Left over from an interrupted update
+    QDir(stagingPath).removeRecursively();
+
+    // Files untouched since the last install need not be read
+    InstallIndex index(destPath);
+    index.load();
+    QSet<QString> archivePaths;
+    QByteArray buffer(RANGE_UPDATE_BUFFER_SIZE, Qt::Uninitialized);
+    for (int i = 0; i < entries.size(); i++)
+    {
+        if (isCancelled())
+        {
+            return;
+        }
+        const ZipEntry &entry = entries[i];
+        QString path = installPath(entry);
+        if (entry.isDir() || path.isEmpty())
+        {
+            continue;
+        }
+        if (!filter.accepts(path.mid(destPath.length() + 1)))
+        {
+            filteredEntries++;
+            continue;
+        }
+        archivePaths.insert(path);
+        if (index.matches(path.mid(destPath.length() + 1), entry.uncompressedSize, entry.crc))
+        {
+            continue;
+        }
+
+        QFile file(path);
+        if (file.size() != static_cast<qint64>(entry.uncompressedSize) || !file.open(QIODevice::ReadOnly))
+        {
+            changedEntries.append(i);
+            continue;
+        }
+        quint32 crc = 0;
+        qint64 length;
+        while ((length = file.read(buffer.data(), buffer.size())) > 0)
+        {
+            crc = Inflater::crc32(reinterpret_cast<const uchar *>(buffer.constData()), length, crc);
+        }
+        if (length < 0 || crc != entry.crc)
+        {
+            changedEntries.append(i);
+        }
+    }
+
+    for (const QString &dir : filter.keptDirs(managedDirs))
+    {
+        QDirIterator it(destPath + '/' + dir, QDir::Files | QDir::Hidden, QDirIterator::Subdirectories);
+        while (it.hasNext())
+        {
+            QString path = it.next();
+            if (!archivePaths.contains(path))
+            {
+                obsoleteFiles.append(path);
+            }
+        }
+    }
+}
+
+void ZipRangeUpdater::scan_finished()
+{
+    worker->deleteLater();
+    worker = nullptr;
+    if (failed)
+    {
+        return;
+    }
+
+    if (filteredEntries > 0)
+    {
+        emit log(QString("Skipping %1 files outside the install profile").arg(filteredEntries));
+    }
+    if (changedEntries.isEmpty() && obsoleteFiles.isEmpty())
+    {
+        endTransfer();
+        if (!stageOnly && !writeIndex(destPath, indexedFiles()))
+        {
+            emit log("Error writing " INSTALL_INDEX_FILE);
+        }
+        emit log("All files are up to date");
+        emit update_complete(destPath);
+        return;
+    }
+
+    planRanges();
+    qint64 archiveBytes = 0;
+    for (const ZipEntry &entry : entries)
+    {
+        archiveBytes += entry.compressedSize;
+    }
+    emit log(QString("%1 of %2 files changed, fetching %3 MB of %4 MB")
+                 .arg(changedEntries.size())
+                 .arg(entries.size())
+                 .arg(bytesTotal / (1024.0 * 1024.0), 0, 'f', 1)
+                 .arg(archiveBytes / (1024.0 * 1024.0), 0, 'f', 1));
+
+    worker = QThread::create([this]() { applyFetched(); });
+    connect(worker, &QThread::finished, this, &ZipRangeUpdater::apply_finished);
+    worker->start();
+
+    if (ranges.isEmpty())
+    {
+        QMutexLocker locker(&mutex);
+        fetchFinished = true;
+        rangeAvailable.wakeOne();
+        return;
+    }
+    requestRanges();
+}
+
+void ZipRangeUpdater::requestRanges()
+{
+    while (!failed && inFlight.size() < RANGE_UPDATE_MAX_REQUESTS && requestNextRange())
+    {
+    }
+}
+
+void ZipRangeUpdater::planRanges()
+{
+    // An entry's bytes run from its local header up to the next entry (or
+    // the central directory), which also covers any data descriptor
+    QList<int> order;
+    for (int i = 0; i < entries.size(); i++)
+    {
+        order.append(i);
+    }
+    std::sort(order.begin(), order.end(), [this](int a, int b) {
+        return entries[a].localHeaderOffset < entries[b].localHeaderOffset;
+    });
+    QHash<int, qint64> entryEnd;
+    for (int k = 0; k < order.size(); k++)
+    {
+        entryEnd.insert(order[k], k + 1 < order.size() ? entries[order[k + 1]].localHeaderOffset : directoryOffset);
+    }
+
+    QList<int> changed = changedEntries;
+    std::sort(changed.begin(), changed.end(), [this](int a, int b) {
+        return entries[a].localHeaderOffset < entries[b].localHeaderOffset;
+    });
+
+    // Neighbouring changes share one request as long as the gap between them
+    // is cheaper to download than another round trip
+    for (int index : changed)
+    {
+        qint64 start = entries[index].localHeaderOffset;
+        qint64 end = entryEnd.value(index) - 1;
+        if (!ranges.isEmpty() && start - ranges.last().end - 1 <= RANGE_UPDATE_MERGE_GAP &&
+            end - ranges.last().start + 1 <= RANGE_UPDATE_MAX_REQUEST_SIZE)
+        {
+            ranges.last().end = end;
+            ranges.last().entries.append(index);
+        }
+        else
+        {
+            ranges.append(FetchRange{start, end, QList<int>() << index});
+        }
+    }
+    for (const FetchRange &range : ranges)
+    {
+        bytesTotal += range.end - range.start + 1;
+    }
+}
+
+bool ZipRangeUpdater::requestNextRange()
+{
+    if (nextRange >= ranges.size())
+    {
+        return false;
+    }
+    {
+        // Held back until the worker has caught up and calls requestRanges()
+        QMutexLocker locker(&mutex);
+        if (queuedBytes >= RANGE_UPDATE_QUEUE_SIZE)
+        {
+            queueFull = true;
+            return false;
+        }
+    }
+    int index = nextRange++;
+    QNetworkReply *reply = network->get(makeRequest(ranges[index].start, ranges[index].end));
+    reply->setProperty("rangeIndex", index);
+    reply->setReadBufferSize(TRANSFER_READ_BUFFER_SIZE);
+    inFlight.insert(reply);
+    rangeBuffers.insert(reply, QByteArray());
+    connect(reply, &QNetworkReply::readyRead, this, &ZipRangeUpdater::range_ready_read);
+    connect(reply, &QNetworkReply::finished, this, &ZipRangeUpdater::range_finished);
+    return true;
+}
+
+void ZipRangeUpdater::drainRange(QNetworkReply *reply)
+{
+    QByteArray chunk = reply->read(network->scheduler()->acquire(transferId, reply->bytesAvailable()));
+    if (!chunk.isEmpty())
+    {
+        rangeBuffers[reply].append(chunk);
+        bytesFetched += chunk.size();
+        emit progress(bytesFetched, bytesTotal);
+    }
+}
+
+void ZipRangeUpdater::range_ready_read()
+{
+    drainRange(qobject_cast<QNetworkReply *>(sender()));
+}
+
+void ZipRangeUpdater::tokens_available()
+{
+    const QList<QNetworkReply *> replies = rangeBuffers.keys();
+    for (QNetworkReply *reply : replies)
+    {
+        if (failed)
+        {
+            return;
+        }
+        if (finishedReplies.contains(reply))
+        {
+            completeRange(reply);
+        }
+        else
+        {
+            drainRange(reply);
+        }
+    }
+}
+
+void ZipRangeUpdater::range_finished()
+{
+    QNetworkReply *reply = qobject_cast<QNetworkReply *>(sender());
+    if (reply->error() != QNetworkReply::NoError)
+    {
+        fail("Network error: " + reply->errorString());
+        return;
+    }
+    if (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 206)
+    {
+        fail("Server does not support range requests");
+        return;
+    }
+    finishedReplies.insert(reply);
+    completeRange(reply);
+}
+
+void ZipRangeUpdater::completeRange(QNetworkReply *reply)
+{
+    drainRange(reply);
+    if (reply->bytesAvailable() > 0)
+    {
+        // Throttled: the rest is read as the scheduler hands out tokens
+        return;
+    }
+    inFlight.remove(reply);
+    finishedReplies.remove(reply);
+    reply->deleteLater();
+
+    int index = reply->property("rangeIndex").toInt();
+    QByteArray data = rangeBuffers.take(reply);
+    if (data.size() != ranges[index].end - ranges[index].start + 1)
+    {
+        fail("Incomplete range response from server");
+        return;
+    }
+
+    {
+        QMutexLocker locker(&mutex);
+        fetched.enqueue(FetchedRange{index, data});
+        queuedBytes += data.size();
+        fetchFinished = nextRange >= ranges.size() && inFlight.isEmpty();
+        rangeAvailable.wakeOne();
+    }
+    requestRanges();
+}
+
+void ZipRangeUpdater::applyFetched()
+{
+    Inflater inflater;
+    while (true)
+    {
+        FetchedRange item;
+        {
+            QMutexLocker locker(&mutex);
+            while (fetched.isEmpty() && !fetchFinished && !cancelled)
+            {
+                rangeAvailable.wait(&mutex);
+            }
+            if (cancelled)
+            {
+                return;
+            }
+            if (fetched.isEmpty())
+            {
+                break;
+            }
+            item = fetched.dequeue();
+        }
+
+        const FetchRange &range = ranges[item.index];
+        const uchar *data = reinterpret_cast<const uchar *>(item.data.constData());
+        for (int index : range.entries)
+        {
+            const ZipEntry &entry = entries[index];
+            qint64 offset = entry.localHeaderOffset - range.start;
+            if (!applyEntry(entry, data + offset, item.data.size() - offset, inflater))
+            {
+                QDir(stagingPath).removeRecursively();
+                return;
+            }
+        }
+
+        bool wake = false;
+        {
+            QMutexLocker locker(&mutex);
+            queuedBytes -= item.data.size();
+            if (queueFull && queuedBytes <= RANGE_UPDATE_QUEUE_SIZE / 2)
+            {
+                queueFull = false;
+                wake = true;
+            }
+        }
+        if (wake)
+        {
+            QMetaObject::invokeMethod(this, [this]() { requestRanges(); }, Qt::QueuedConnection);
+        }
+    }
+
+    // Every changed file is fetched and verified; only now does the install change
+    if (stageOnly)
+    {
+        return;
+    }
+    if (!commitStaged(destPath, stagingPath, obsoleteFiles, &applyError))
+    {
+        return;
+    }
+    if (!writeIndex(destPath, indexedFiles()))
+    {
+        emit log("Error writing " INSTALL_INDEX_FILE);
+    }
+    if (!obsoleteFiles.isEmpty())
+    {
+        emit log(QString("Removed %1 files no longer in the build").arg(obsoleteFiles.size()));
+    }
+}
+
+bool ZipRangeUpdater::commitStaged(const QString &destPath, const QString &stagingPath, const QStringList &obsolete,
+                                   QString *errorMessage)
+{
+    // Replaced and obsolete files go to the trash, which the launcher empties
+    // in the background
+    InstallSwap swap(UnzipThread::trashPath(destPath));
+    bool swapped = true;
+    for (const QString &path : obsolete)
+    {
+        if (!swap.discard(path))
+        {
+            swapped = false;
+            break;
+        }
+    }
+    if (!swapped || (QFileInfo::exists(stagingPath) && !swap.moveTree(stagingPath, destPath)))
+    {
+        swap.rollback();
+        *errorMessage = swap.errorMessage() + ", installed files were left unchanged";
+        QDir(stagingPath).removeRecursively();
+        return false;
+    }
+    QDir(stagingPath).removeRecursively();
+    return true;
+}
+
+bool ZipRangeUpdater::applyEntry(const ZipEntry &entry, const uchar *header, qint64 available, Inflater &inflater)
+{
+    if (available < ZIP_LOCAL_HEADER_SIZE || ZipDirectory::le32(header) != ZIP_LOCAL_HEADER_SIGNATURE)
+    {
+        applyError = "Corrupt local header for " + entry.name;
+        return false;
+    }
+    if (entry.flags & 0x0001)
+    {
+        applyError = "Encrypted entries are not supported: " + entry.name;
+        return false;
+    }
+    qint64 headerLength = ZipDirectory::localHeaderLength(header);
+    if (headerLength + static_cast<qint64>(entry.compressedSize) > available)
+    {
+        applyError = "Truncated data for " + entry.name;
+        return false;
+    }
+    const uchar *compressed = header + headerLength;
+    if (entry.method != 0 && entry.method != 8)
+    {
+        applyError = "Unsupported compression method for " + entry.name;
+        return false;
+    }
+
+    // Staged next to the install, which is only touched once every entry is in
+    QString path = stagingPath + '/' + installPath(entry).mid(destPath.length() + 1);
+    QFileInfo(path).dir().mkpath(".");
+    QFile out(path);
+    if (!out.open(QIODevice::WriteOnly))
+    {
+        applyError = "Error writing to file " + path;
+        return false;
+    }
+
+    quint32 crc = 0;
+    if (entry.method == 8 && entry.uncompressedSize > RANGE_UPDATE_BUFFER_SIZE)
+    {
+        // Large entries, the card databases above all, are inflated a buffer
+        // at a time instead of into one allocation of their full size
+        if (!inflateToFile(entry, compressed, out, &crc))
+        {
+            return false;
+        }
+    }
+    else
+    {
+        QByteArray content;
+        if (entry.method == 0)
+        {
+            content = QByteArray::fromRawData(reinterpret_cast<const char *>(compressed), entry.compressedSize);
+        }
+        else
+        {
+            content.resize(entry.uncompressedSize);
+            if (entry.uncompressedSize > 0 &&
+                !inflater.inflate(compressed, entry.compressedSize, reinterpret_cast<uchar *>(content.data()), content.size()))
+            {
+                applyError = "Error decompressing " + entry.name;
+                return false;
+            }
+        }
+        crc = Inflater::crc32(reinterpret_cast<const uchar *>(content.constData()), content.size());
+        if (out.write(content) != content.size())
+        {
+            applyError = "Error writing to file " + path;
+            return false;
+        }
+    }
+
+    if (crc != entry.crc)
+    {
+        applyError = "CRC mismatch for " + entry.name;
+        return false;
+    }
+    if (!out.flush())
+    {
+        applyError = "Error writing to file " + path;
+        return false;
+    }
+    return true;
+}
+
+bool ZipRangeUpdater::inflateToFile(const ZipEntry &entry, const uchar *compressed, QFile &out, quint32 *crc)
+{
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (inflateInit2(&stream, -MAX_WBITS) != Z_OK)
+    {
+        applyError = "Error initializing inflater for " + entry.name;
+        return false;
+    }
+    QByteArray buffer(RANGE_UPDATE_BUFFER_SIZE, Qt::Uninitialized);
+    qint64 inputLeft = entry.compressedSize;
+    qint64 written = 0;
+    int result = Z_OK;
+    stream.next_in = const_cast<Bytef *>(compressed);
+    while (result != Z_STREAM_END)
+    {
+        if (stream.avail_in == 0 && inputLeft > 0)
+        {
+            // avail_in is 32 bits wide
+            uInt chunk = static_cast<uInt>(qMin<qint64>(inputLeft, 1 << 30));
+            stream.avail_in = chunk;
+            inputLeft -= chunk;
+        }
+        stream.next_out = reinterpret_cast<Bytef *>(buffer.data());
+        stream.avail_out = static_cast<uInt>(buffer.size());
+        result = inflate(&stream, Z_NO_FLUSH);
+        if (result != Z_OK && result != Z_STREAM_END)
+        {
+            break;
+        }
+        // Input running out before the end of the stream is a Z_BUF_ERROR
+        qint64 produced = buffer.size() - stream.avail_out;
+        *crc = Inflater::crc32(reinterpret_cast<const uchar *>(buffer.constData()), produced, *crc);
+        written += produced;
+        if (out.write(buffer.constData(), produced) != produced)
+        {
+            inflateEnd(&stream);
+            applyError = "Error writing to file " + out.fileName();
+            return false;
+        }
+    }
+    inflateEnd(&stream);
+    if (result != Z_STREAM_END || written != static_cast<qint64>(entry.uncompressedSize))
+    {
+        applyError = "Error decompressing " + entry.name;
+        return false;
+    }
+    return true;
+}
+
+void ZipRangeUpdater::apply_finished()
+{
+    worker->deleteLater();
+    worker = nullptr;
+    if (failed)
+    {
+        return;
+    }
+    if (!applyError.isEmpty())
+    {
+        fail(applyError);
+        return;
+    }
+    endTransfer();
+    emit log(QString(stageOnly ? "Staged %1 changed files" : "Updated %1 files").arg(changedEntries.size()));
+    emit update_complete(destPath);
+}
+
+void ZipRangeUpdater::endTransfer()
+{
+    if (transferId != 0)
+    {
+        disconnect(network->scheduler(), nullptr, this, nullptr);
+        network->scheduler()->removeTransfer(transferId);
+        transferId = 0;
+    }
+}
+
+void ZipRangeUpdater::stopWorker()
+{
+    if (worker == nullptr)
+    {
+        return;
+    }
+    {
+        QMutexLocker locker(&mutex);
+        cancelled = true;
+        rangeAvailable.wakeOne();
+    }
+    disconnect(worker, nullptr, this, nullptr);
+    worker->wait();
+    delete worker;
+    worker = nullptr;
+}
+
+void ZipRangeUpdater::fail(const QString &errorMessage)
+{
+    if (failed)
+    {
+        return;
+    }
+    failed = true;
+    for (QNetworkReply *reply : inFlight)
+    {
+        disconnect(reply, nullptr, this, nullptr);
+        reply->abort();
+        reply->deleteLater();
+    }
+    inFlight.clear();
+    rangeBuffers.clear();
+    finishedReplies.clear();
+    endTransfer();
+    stopWorker();
+    emit update_fail(errorMessage);
+}
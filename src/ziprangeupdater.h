@@ -0,0 +1,157 @@
+#ifndef ZIPRANGEUPDATER_H
+#define ZIPRANGEUPDATER_H
+
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QSet>
+#include <QMutex>
+#include <QQueue>
+#include <QString>
+#include <QStringList>
+#include <QThread>
+#include <QUrl>
+#include <QWaitCondition>
+#include <QtNetwork/QNetworkReply>
+#include <QtNetwork/QNetworkRequest>
+#include "inflater.h"
+#include "installfilter.h"
+#include "networkservice.h"
+#include "zipdirectory.h"
+
+#define RANGE_UPDATE_TAIL_SIZE (64 * 1024)
+#define RANGE_UPDATE_MAX_REQUESTS 4
+#define RANGE_UPDATE_MERGE_GAP (64 * 1024)
+#define RANGE_UPDATE_MAX_REQUEST_SIZE (32 * 1024 * 1024)
+#define RANGE_UPDATE_BUFFER_SIZE (1024 * 1024)
+// Fetched ranges waiting for the worker; no new request starts beyond this
+#define RANGE_UPDATE_QUEUE_SIZE (64 * 1024 * 1024)
+#define RANGE_UPDATE_STAGING_DIR ".range-staging"
+
+// Brings an installed build up to date with a remote zip using HTTP range
+// requests. Only the end of the archive and its central directory are read
+// up front; installed files are compared against the entry sizes and CRCs,
+// and just the changed entries are fetched, inflated and verified into
+// <destPath>/.range-staging. Once all of them are in, they are moved over
+// the installed files in one InstallSwap and files under managedDirs that
+// are no longer in the archive are removed with it, so a failure at any
+// point leaves the installed build as it was. Entries the install filter
+// leaves out are never fetched. No new range is requested while more than
+// RANGE_UPDATE_QUEUE_SIZE bytes wait for the worker, and large entries are
+// inflated into their staging file a buffer at a time.
+//
+// Installed files that still match the InstallIndex are taken as unchanged
+// without being read, and the index is rewritten after the update.
+//
+// With setStageOnly() the changed files are left staged for UpdateStager
+// to apply on a later launch, and obsolete() lists what to remove then and
+// indexedFiles() what to record in the index.
+class ZipRangeUpdater : public QObject
+{
+    Q_OBJECT
+public:
+    ZipRangeUpdater(NetworkService *network, const QUrl &url, const QString &destPath,
+                    const QStringList &managedDirs, QObject *parent = nullptr);
+    ~ZipRangeUpdater();
+    void setFilter(const InstallFilter &filter);
+    void setPriority(TransferScheduler::Priority priority);
+    // Stages the changed files in stagingPath and stops there
+    void setStageOnly(const QString &stagingPath);
+    // Files to remove, relative to destPath; valid after update_complete()
+    QStringList obsolete() const;
+    // [path, size, crc] of every file of the new build, relative to destPath
+    QJsonArray indexedFiles() const;
+    // Rewrites the InstallIndex of destPath from indexedFiles()
+    static bool writeIndex(const QString &destPath, const QJsonArray &files);
+    void start();
+    // Moves the files under stagingPath into destPath and takes the obsolete
+    // ones out, all or nothing; stagingPath is removed either way
+    static bool commitStaged(const QString &destPath, const QString &stagingPath, const QStringList &obsolete,
+                             QString *errorMessage);
+
+signals:
+    void log(QString message);
+    void progress(qint64 bytesReceived, qint64 bytesTotal);
+    void update_complete(QString installLocation);
+    void update_fail(QString errorMessage);
+
+private:
+    struct FetchRange
+    {
+        qint64 start;
+        qint64 end; // Inclusive
+        QList<int> entries;
+    };
+
+    struct FetchedRange
+    {
+        int index;
+        QByteArray data;
+    };
+
+    NetworkService *network;
+    QUrl url;
+    QString destPath;
+    QString stagingPath;
+    bool stageOnly = false;
+    TransferScheduler::Priority priority = TransferScheduler::Interactive;
+    QStringList managedDirs;
+    InstallFilter filter;
+    int filteredEntries = 0;
+    qint64 directoryOffset = 0;
+    QList<ZipEntry> entries;
+    QString rootFolder;
+    QList<int> changedEntries;
+    QStringList obsoleteFiles;
+    QList<FetchRange> ranges;
+    int nextRange = 0;
+    qint64 bytesTotal = 0;
+    qint64 bytesFetched = 0;
+    QSet<QNetworkReply *> inFlight;
+    QHash<QNetworkReply *, QByteArray> rangeBuffers;
+    QSet<QNetworkReply *> finishedReplies; // Finished, but paced data is still buffered
+    int transferId = 0;
+    QThread *worker = nullptr;
+    QString applyError; // Set by the worker, read once it has finished
+    bool failed = false;
+
+    // Hand-off of fetched ranges to the worker thread
+    QMutex mutex;
+    QWaitCondition rangeAvailable;
+    QQueue<FetchedRange> fetched;
+    qint64 queuedBytes = 0;
+    bool queueFull = false;
+    bool fetchFinished = false;
+    bool cancelled = false;
+
+    QNetworkRequest makeRequest(qint64 start, qint64 end) const;
+    QNetworkReply *checkReply(QNetworkReply *reply);
+    void parseDirectory(const QByteArray &directory);
+    void planRanges();
+    void requestRanges();
+    bool requestNextRange();
+    void drainRange(QNetworkReply *reply);
+    void completeRange(QNetworkReply *reply);
+    void endTransfer();
+    void stopWorker();
+    void fail(const QString &errorMessage);
+    QString installPath(const ZipEntry &entry) const;
+    bool isCancelled();
+
+    // Worker thread
+    void scanInstalled();
+    void applyFetched();
+    bool applyEntry(const ZipEntry &entry, const uchar *header, qint64 available, Inflater &inflater);
+    bool inflateToFile(const ZipEntry &entry, const uchar *compressed, QFile &out, quint32 *crc);
+
+private slots:
+    void tail_finished();
+    void directory_finished();
+    void scan_finished();
+    void range_ready_read();
+    void range_finished();
+    void tokens_available();
+    void apply_finished();
+};
+
+#endif // ZIPRANGEUPDATER_H
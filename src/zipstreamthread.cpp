@@ -0,0 +1,408 @@
+#include "zipstreamthread.h"
+#include "installindex.h"
+#include "zipdirectory.h"
+#include <QFileInfo>
+#include <cstring>
+
+ZipStreamThread::ZipStreamThread(QString destPath, QStringList cleanDirs)
+    : StreamExtractThread(destPath)
+{
+    this->cleanDirs = cleanDirs;
+    outBuffer.resize(ZIP_STREAM_BUFFER_SIZE);
+}
+
+ZipStreamThread::~ZipStreamThread()
+{
+    closeEntry();
+}
+
+void ZipStreamThread::closeEntry()
+{
+    if (inflaterActive)
+    {
+        inflateEnd(&inflater);
+        inflaterActive = false;
+    }
+    if (out.isOpen())
+    {
+        out.close();
+    }
+}
+
+bool ZipStreamThread::consume(const char *data, qint64 size)
+{
+    // Headers can straddle chunk boundaries, so everything goes through
+    // buffer and only the consumed prefix is dropped afterwards
+    buffer.append(data, size);
+    qint64 pos = 0;
+    bool ok = true;
+    while (ok)
+    {
+        qint64 available = buffer.size() - pos;
+        const uchar *p = reinterpret_cast<const uchar *>(buffer.constData()) + pos;
+
+        if (state == CentralDirectory)
+        {
+            trailer.append(buffer.constData() + pos, available);
+            pos = buffer.size();
+            break;
+        }
+        else if (state == Signature)
+        {
+            if (available < 4)
+            {
+                break;
+            }
+            quint32 signature = ZipDirectory::le32(p);
+            if (signature == ZIP_LOCAL_HEADER_SIGNATURE)
+            {
+                state = LocalHeader;
+            }
+            else if (signature == ZIP_CENTRAL_HEADER_SIGNATURE ||
+                     signature == ZIP_END_OF_CENTRAL_DIR_SIGNATURE ||
+                     signature == ZIP64_END_OF_CENTRAL_DIR_SIGNATURE)
+            {
+                state = CentralDirectory;
+            }
+            else
+            {
+                errorMessage = "Unzip: Unexpected data in zip stream";
+                ok = false;
+            }
+        }
+        else if (state == LocalHeader)
+        {
+            if (available < ZIP_LOCAL_HEADER_SIZE)
+            {
+                break;
+            }
+            qint64 headerLength = ZipDirectory::localHeaderLength(p);
+            if (available < headerLength)
+            {
+                break;
+            }
+            ok = parseLocalHeader(p);
+            pos += headerLength;
+        }
+        else if (state == EntryData)
+        {
+            if (available == 0 && !(method == 0 && compressedRemaining == 0))
+            {
+                break;
+            }
+            qint64 used = consumeEntryData(buffer.constData() + pos, available);
+            if (used < 0)
+            {
+                ok = false;
+            }
+            else
+            {
+                pos += used;
+            }
+        }
+        else if (state == DataDescriptor)
+        {
+            if (available < 4)
+            {
+                break;
+            }
+            qint64 offset = ZipDirectory::le32(p) == ZIP_DATA_DESCRIPTOR_SIGNATURE ? 4 : 0;
+            qint64 descriptorLength = offset + 4 + (zip64 ? 16 : 8);
+            if (available < descriptorLength)
+            {
+                break;
+            }
+            expectedCrc = ZipDirectory::le32(p + offset);
+            uncompressedSize = zip64 ? ZipDirectory::le64(p + offset + 12) : ZipDirectory::le32(p + offset + 8);
+            pos += descriptorLength;
+            ok = finishEntry();
+        }
+    }
+
+    if (pos >= buffer.size())
+    {
+        buffer.clear();
+    }
+    else
+    {
+        buffer.remove(0, pos);
+    }
+    return ok;
+}
+
+bool ZipStreamThread::parseLocalHeader(const uchar *p)
+{
+    flags = ZipDirectory::le16(p + 6);
+    method = ZipDirectory::le16(p + 8);
+    expectedCrc = ZipDirectory::le32(p + 14);
+    quint64 compressedSize = ZipDirectory::le32(p + 18);
+    uncompressedSize = ZipDirectory::le32(p + 22);
+    quint16 nameLength = ZipDirectory::le16(p + 26);
+    quint16 extraLength = ZipDirectory::le16(p + 28);
+    QString name = QString::fromUtf8(reinterpret_cast<const char *>(p + 30), nameLength);
+
+    // Zip64 sizes live in extra field 0x0001; its presence also means the
+    // data descriptor (if any) carries 8-byte sizes
+    zip64 = false;
+    const uchar *extra = p + 30 + nameLength;
+    int offset = 0;
+    while (offset + 4 <= extraLength)
+    {
+        quint16 id = ZipDirectory::le16(extra + offset);
+        quint16 length = ZipDirectory::le16(extra + offset + 2);
+        if (offset + 4 + length > extraLength)
+        {
+            break;
+        }
+        if (id == 0x0001)
+        {
+            zip64 = true;
+            const uchar *field = extra + offset + 4;
+            int fieldOffset = 0;
+            if (uncompressedSize == 0xFFFFFFFF && fieldOffset + 8 <= length)
+            {
+                uncompressedSize = ZipDirectory::le64(field + fieldOffset);
+                fieldOffset += 8;
+            }
+            if (compressedSize == 0xFFFFFFFF && fieldOffset + 8 <= length)
+            {
+                compressedSize = ZipDirectory::le64(field + fieldOffset);
+            }
+        }
+        offset += 4 + length;
+    }
+
+    return beginEntry(name, compressedSize);
+}
+
+bool ZipStreamThread::beginEntry(const QString &name, quint64 compressedSize)
+{
+    entryName = name;
+    entryPath.clear();
+    if (flags & 0x0001)
+    {
+        errorMessage = "Unzip: Encrypted entries are not supported: " + name;
+        return false;
+    }
+    if (method != 0 && method != 8)
+    {
+        errorMessage = "Unzip: Unsupported compression method for " + name;
+        return false;
+    }
+    if (method == 0 && (flags & 0x0008))
+    {
+        // A stored entry whose size only follows the data cannot be found
+        // in a stream; the caller falls back to a regular download
+        errorMessage = "Unzip: Stored entry without size in stream: " + name;
+        return false;
+    }
+
+    QString cleaned;
+    if (!safeEntryPath(name, &cleaned))
+    {
+        return false;
+    }
+
+    // Entries left out are still inflated and checked, just not written
+    bool skip = !wanted(cleaned, true);
+    QString outPath = stagingPath + '/' + cleaned;
+    if (name.endsWith('/'))
+    {
+        if (!skip)
+        {
+            QDir().mkpath(outPath);
+        }
+    }
+    else if (!skip)
+    {
+        // Ensure parent directory exists
+        QFileInfo(outPath).dir().mkpath(".");
+        out.setFileName(outPath);
+        if (!out.open(QIODevice::WriteOnly))
+        {
+            errorMessage = "Unzip: Error creating file " + name;
+            return false;
+        }
+        entryPath = cleaned;
+    }
+
+    compressedRemaining = compressedSize;
+    crc = crc32(0L, Z_NULL, 0);
+    written = 0;
+    if (method == 8)
+    {
+        memset(&inflater, 0, sizeof(inflater));
+        if (inflateInit2(&inflater, -MAX_WBITS) != Z_OK)
+        {
+            errorMessage = "Unzip: Error initializing inflater for " + name;
+            return false;
+        }
+        inflaterActive = true;
+    }
+    state = EntryData;
+    return true;
+}
+
+qint64 ZipStreamThread::consumeEntryData(const char *data, qint64 size)
+{
+    if (method == 0)
+    {
+        qint64 length = static_cast<qint64>(qMin<quint64>(compressedRemaining, size));
+        if (!writeOut(data, length))
+        {
+            return -1;
+        }
+        compressedRemaining -= length;
+        if (compressedRemaining == 0 && !finishEntry())
+        {
+            return -1;
+        }
+        return length;
+    }
+
+    // Deflate: zlib tells us where the entry ends, which also covers
+    // entries whose sizes only follow in a data descriptor
+    inflater.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+    inflater.avail_in = static_cast<uInt>(size);
+    int ret;
+    do
+    {
+        inflater.next_out = reinterpret_cast<Bytef *>(outBuffer.data());
+        inflater.avail_out = static_cast<uInt>(outBuffer.size());
+        ret = inflate(&inflater, Z_NO_FLUSH);
+        if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR)
+        {
+            errorMessage = "Unzip: Error inflating " + entryName;
+            return -1;
+        }
+        if (!writeOut(outBuffer.constData(), outBuffer.size() - inflater.avail_out))
+        {
+            return -1;
+        }
+    } while (ret != Z_STREAM_END && inflater.avail_out == 0);
+
+    qint64 used = size - inflater.avail_in;
+    if (ret == Z_STREAM_END)
+    {
+        inflateEnd(&inflater);
+        inflaterActive = false;
+        if (flags & 0x0008)
+        {
+            state = DataDescriptor;
+        }
+        else if (!finishEntry())
+        {
+            return -1;
+        }
+    }
+    return used;
+}
+
+bool ZipStreamThread::writeOut(const char *data, qint64 size)
+{
+    if (size <= 0)
+    {
+        return true;
+    }
+    crc = crc32(crc, reinterpret_cast<const Bytef *>(data), static_cast<uInt>(size));
+    written += size;
+    if (out.isOpen() && out.write(data, size) != size)
+    {
+        errorMessage = "Unzip: Error writing to file " + entryName;
+        return false;
+    }
+    return true;
+}
+
+bool ZipStreamThread::finishEntry()
+{
+    closeEntry();
+    if (out.error() != QFileDevice::NoError)
+    {
+        errorMessage = "Unzip: Error writing to file " + entryName;
+        return false;
+    }
+    if (crc != expectedCrc || written != uncompressedSize)
+    {
+        errorMessage = "Unzip: CRC mismatch in " + entryName;
+        return false;
+    }
+    extracted.insert(entryName, ExtractedEntry{crc, written, entryPath});
+    state = Signature;
+    return true;
+}
+
+bool ZipStreamThread::complete()
+{
+    if (state != CentralDirectory)
+    {
+        errorMessage = "Unzip: Archive ended before its central directory";
+        return false;
+    }
+    if (!verifyCentralDirectory())
+    {
+        return false;
+    }
+    if (!installStaged(true, cleanDirs))
+    {
+        return false;
+    }
+    writeIndex();
+    return true;
+}
+
+void ZipStreamThread::writeIndex()
+{
+    // Lets a later UnzipThread or ZipRangeUpdater skip the unchanged files
+    InstallIndex index(destPath);
+    for (const ExtractedEntry &entry : std::as_const(extracted))
+    {
+        if (entry.path.isEmpty())
+        {
+            continue;
+        }
+        QString path = entry.path;
+        if (!strippedRoot.isEmpty())
+        {
+            path = path.section('/', 1);
+        }
+        index.insert(path, entry.size, entry.crc);
+    }
+    if (!index.save())
+    {
+        emit log("Unzip: Error writing " INSTALL_INDEX_FILE);
+    }
+}
+
+bool ZipStreamThread::verifyCentralDirectory()
+{
+    QList<ZipEntry> entries;
+    if (!ZipDirectory::parseCentralDirectory(trailer, &entries))
+    {
+        errorMessage = "Unzip: Error reading the central directory";
+        return false;
+    }
+
+    for (const ZipEntry &entry : entries)
+    {
+        auto it = extracted.constFind(entry.name);
+        if (it == extracted.constEnd())
+        {
+            errorMessage = "Unzip: " + entry.name + " is listed in the central directory but was not in the archive stream";
+            return false;
+        }
+        if (!entry.isDir() && (it->crc != entry.crc || it->size != entry.uncompressedSize))
+        {
+            errorMessage = "Unzip: " + entry.name + " does not match the central directory";
+            return false;
+        }
+    }
+
+    if (entries.size() != extracted.size())
+    {
+        errorMessage = "Unzip: Central directory does not match the extracted entries";
+        return false;
+    }
+    emit log(QString("Verified %1 entries against the central directory").arg(entries.size()));
+    return true;
+}
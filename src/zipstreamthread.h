@@ -0,0 +1,79 @@
+#ifndef ZIPSTREAMTHREAD_H
+#define ZIPSTREAMTHREAD_H
+
+#include <QFile>
+#include <QHash>
+#include <QStringList>
+#include <zlib.h>
+#include "streamextractthread.h"
+
+#define ZIP_STREAM_BUFFER_SIZE (256 * 1024)
+
+// Extracts a zip archive from its byte stream by walking the local file
+// headers in order, so entries are written while the rest of the archive is
+// still downloading. The central directory at the end of the stream is used
+// to check that every entry was seen with the right size and CRC before the
+// result is moved into place, and the installed files are then recorded in
+// the destination's InstallIndex.
+class ZipStreamThread : public StreamExtractThread
+{
+    Q_OBJECT
+public:
+    ZipStreamThread(QString destPath, QStringList cleanDirs = QStringList());
+    ~ZipStreamThread();
+
+protected:
+    bool consume(const char *data, qint64 size) override;
+    bool complete() override;
+
+private:
+    enum State
+    {
+        Signature,
+        LocalHeader,
+        EntryData,
+        DataDescriptor,
+        CentralDirectory
+    };
+
+    struct ExtractedEntry
+    {
+        quint32 crc;
+        quint64 size;
+        QString path; // Cleaned path in staging; empty if not written
+    };
+
+    QStringList cleanDirs;
+    State state = Signature;
+    QByteArray buffer;
+    QByteArray trailer;
+    QByteArray outBuffer;
+
+    // Current entry
+    QString entryName;
+    QString entryPath;
+    QFile out;
+    quint16 flags = 0;
+    quint16 method = 0;
+    quint32 expectedCrc = 0;
+    quint64 compressedRemaining = 0;
+    quint64 uncompressedSize = 0;
+    bool zip64 = false;
+    quint32 crc = 0;
+    quint64 written = 0;
+    z_stream inflater;
+    bool inflaterActive = false;
+
+    QHash<QString, ExtractedEntry> extracted;
+
+    bool parseLocalHeader(const uchar *p);
+    bool beginEntry(const QString &name, quint64 compressedSize);
+    qint64 consumeEntryData(const char *data, qint64 size);
+    bool finishEntry();
+    bool writeOut(const char *data, qint64 size);
+    bool verifyCentralDirectory();
+    void writeIndex();
+    void closeEntry();
+};
+
+#endif // ZIPSTREAMTHREAD_H
@@ -2,7 +2,7 @@ QT       += core gui network
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
-CONFIG += c++11
+CONFIG += c++17
 
 # Executable metadata. On Windows these populate the PE VERSIONINFO resource;
 # an unsigned binary with no version/company info looks more suspicious to AV
@@ -18,23 +18,63 @@ QMAKE_TARGET_COPYRIGHT   = "GPL-3.0 — github.com/t-my/xmage-launcher-qt"
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+    src/diskwriterthread.cpp \
     src/downloadmanager.cpp \
-    src/zipextractthread.cpp \
+    src/filedownload.cpp \
+    src/inflater.cpp \
+    src/installfilter.cpp \
+    src/installindex.cpp \
+    src/installswap.cpp \
+    src/linesplitter.cpp \
+    src/logbuffer.cpp \
+    src/logview.cpp \
     src/main.cpp \
     src/mainwindow.cpp \
+    src/networkservice.cpp \
+    src/progresstracker.cpp \
+    src/sessionlogwriter.cpp \
     src/settings.cpp \
     src/settingsdialog.cpp \
+    src/streamdecoder.cpp \
+    src/streamextractthread.cpp \
+    src/tarstreamthread.cpp \
+    src/taskgraph.cpp \
+    src/transferscheduler.cpp \
     src/unzipthread.cpp \
-    src/xmageprocess.cpp
+    src/updatestager.cpp \
+    src/xmageprocess.cpp \
+    src/zipdirectory.cpp \
+    src/ziprangeupdater.cpp \
+    src/zipstreamthread.cpp
 
 HEADERS += \
+    src/diskwriterthread.h \
     src/downloadmanager.h \
-    src/zipextractthread.h \
+    src/filedownload.h \
+    src/inflater.h \
+    src/installfilter.h \
+    src/installindex.h \
+    src/installswap.h \
+    src/linesplitter.h \
+    src/logbuffer.h \
+    src/logview.h \
     src/mainwindow.h \
+    src/networkservice.h \
+    src/progresstracker.h \
+    src/sessionlogwriter.h \
     src/settings.h \
     src/settingsdialog.h \
+    src/streamdecoder.h \
+    src/streamextractthread.h \
+    src/tarstreamthread.h \
+    src/taskgraph.h \
+    src/transferscheduler.h \
     src/unzipthread.h \
-    src/xmageprocess.h
+    src/updatestager.h \
+    src/xmageprocess.h \
+    src/zipdirectory.h \
+    src/ziprangeupdater.h \
+    src/zipstreamthread.h
 
 FORMS += \
     forms/mainwindow.ui \
@@ -45,9 +85,19 @@ FORMS += \
 RESOURCES += \
     resources/resources.qrc
 
+# Optional faster inflate and CRC32 for zip entries: qmake CONFIG+=libdeflate
+libdeflate {
+    DEFINES += USE_LIBDEFLATE
+    macx: INCLUDEPATH += /opt/homebrew/opt/libdeflate/include
+    macx: LIBS += -L/opt/homebrew/opt/libdeflate/lib
+    LIBS += -ldeflate
+}
+
 macx {
     INCLUDEPATH += /opt/homebrew/opt/libzip/include
-    LIBS += -L/opt/homebrew/opt/libzip/lib -lzip
+    INCLUDEPATH += /opt/homebrew/opt/zstd/include /opt/homebrew/opt/xz/include
+    LIBS += -L/opt/homebrew/opt/libzip/lib -lzip -lz
+    LIBS += -L/opt/homebrew/opt/zstd/lib -L/opt/homebrew/opt/xz/lib -lzstd -llzma
     ICON = resources/icon-mage.icns
 
     # Copy settings.json inside .app bundle, deploy Qt frameworks, and sign
@@ -59,13 +109,13 @@ macx {
     QMAKE_CLEAN += -r $${TARGET}.app
 }
 linux {
-    LIBS += -lzip
+    LIBS += -lzip -lz -lzstd -llzma
     QMAKE_POST_LINK += cp $$PWD/settings.json .
     QMAKE_CLEAN += settings.json
 }
 win32 {
     RC_ICONS = resources/icon-mage.ico
-    LIBS += -lzip -lbz2 -llzma -lmsi
+    LIBS += -lzip -lz -lbz2 -llzma -lzstd -lmsi
     QMAKE_POST_LINK += cp $$PWD/settings.json .
     QMAKE_CLEAN += settings.json
 }